@@ -0,0 +1,515 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <cfloat>
+#include <algorithm>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+
+// Axis aligned box
+struct AABB
+{
+    glm::vec3 Min, Max;
+
+    // An empty box, growing it by anything gives that thing's bounds
+    AABB( ) : Min( FLT_MAX ), Max( -FLT_MAX )
+    {
+    }
+
+    AABB( glm::vec3 min, glm::vec3 max ) : Min( min ), Max( max )
+    {
+    }
+
+    void Grow( glm::vec3 point )
+    {
+        this->Min = glm::min( this->Min, point );
+        this->Max = glm::max( this->Max, point );
+    }
+
+    void Grow( const AABB &box )
+    {
+        this->Min = glm::min( this->Min, box.Min );
+        this->Max = glm::max( this->Max, box.Max );
+    }
+
+    // Half the surface area, which is all the SAH needs. An empty box has none.
+    GLfloat HalfArea( ) const
+    {
+        glm::vec3 extent = this->Max - this->Min;
+        if ( extent.x < 0.0f || extent.y < 0.0f || extent.z < 0.0f )
+        {
+            return 0.0f;
+        }
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    glm::vec3 Center( ) const
+    {
+        return ( this->Min + this->Max ) * 0.5f;
+    }
+
+    bool Overlaps( const AABB &box ) const
+    {
+        return this->Min.x <= box.Max.x && box.Min.x <= this->Max.x
+            && this->Min.y <= box.Max.y && box.Min.y <= this->Max.y
+            && this->Min.z <= box.Max.z && box.Min.z <= this->Max.z;
+    }
+};
+
+// One node of the flattened tree, 32 bytes so two share a cache line. Interior nodes have Count 0 and their children at
+// LeftFirst and LeftFirst + 1, leaves hold Count primitives starting at LeftFirst in the tree's primitive order.
+struct BVHNode
+{
+    glm::vec3 Min;
+    GLuint LeftFirst;
+    glm::vec3 Max;
+    GLuint Count;
+};
+
+// Bounding volume hierarchy over static primitives given by their boxes, e.g. the quads of the staircase and the lamps.
+// Built top down with the surface area heuristic evaluated on a fixed number of bins per axis, so a build is linear per level
+// instead of sorting. Nodes live in one array in depth first order with siblings next to each other, and the primitive
+// boxes are copied into leaf order so a leaf reads one contiguous run of them. Queries report the ids the primitives were
+// given to Build with.
+class BVH
+{
+public:
+    BVH( )
+    {
+    }
+
+    // Rebuilds the tree over 'boxes', primitive i gets id i
+    void Build( const std::vector<AABB> &boxes )
+    {
+        this->nodes.clear( );
+        this->boxes = boxes;
+        this->ids.resize( boxes.size( ) );
+        this->centers.resize( boxes.size( ) );
+        AABB bounds;
+        for ( size_t i = 0; i < boxes.size( ); i++ )
+        {
+            this->ids[i] = ( GLuint )i;
+            this->centers[i] = boxes[i].Center( );
+            bounds.Grow( boxes[i] );
+        }
+        if ( boxes.empty( ) )
+        {
+            return;
+        }
+
+        // A binary tree over n leaves has at most 2n - 1 nodes, the slot after the root stays empty so siblings pair up
+        this->nodes.reserve( 2 * boxes.size( ) );
+        BVHNode root;
+        root.Min = bounds.Min;
+        root.Max = bounds.Max;
+        root.LeftFirst = 0;
+        root.Count = ( GLuint )boxes.size( );
+        this->nodes.push_back( root );
+        this->nodes.push_back( root );
+
+        // Pairs of node and depth. Splitting sets the bounds of the children, so nothing is ever refitted.
+        std::vector<GLuint> stack;
+        stack.push_back( 0 );
+        stack.push_back( 0 );
+        while ( !stack.empty( ) )
+        {
+            GLuint depth = stack.back( );
+            stack.pop_back( );
+            GLuint node = stack.back( );
+            stack.pop_back( );
+
+            GLuint left = ( depth < MAX_DEPTH ) ? this->split( node ) : 0;
+            if ( 0 != left )
+            {
+                stack.push_back( left + 1 );
+                stack.push_back( depth + 1 );
+                stack.push_back( left );
+                stack.push_back( depth + 1 );
+            }
+        }
+
+        // The centers were only needed while building
+        std::vector<glm::vec3>( ).swap( this->centers );
+    }
+
+    GLuint GetNodeCount( ) const
+    {
+        return ( GLuint )this->nodes.size( );
+    }
+
+    GLuint GetPrimitiveCount( ) const
+    {
+        return ( GLuint )this->ids.size( );
+    }
+
+    // Appends the ids of the primitives whose boxes are at least partly inside the frustum, in no particular order.
+    // Subtrees completely inside the frustum are taken without testing any further plane.
+    void QueryFrustum( const Frustum &frustum, std::vector<GLuint> &result ) const
+    {
+        if ( this->nodes.empty( ) )
+        {
+            return;
+        }
+
+        // Every entry carries the planes its node still has to be tested against, one bit per plane
+        const GLuint ALL_PLANES = ( 1u << 6 ) - 1;
+        GLuint stack[2 * STACK_SIZE];
+        GLuint top = 0;
+        stack[top++] = 0;
+        stack[top++] = ALL_PLANES;
+        while ( top > 0 )
+        {
+            GLuint planes = stack[--top];
+            const BVHNode &node = this->nodes[stack[--top]];
+
+            bool outside = false;
+            for ( GLuint p = 0; p < 6 && !outside; p++ )
+            {
+                if ( !( planes & ( 1u << p ) ) )
+                {
+                    continue;
+                }
+
+                const glm::vec4 &plane = frustum.Planes[p];
+                // Corners furthest along the normal and against it
+                glm::vec3 positive( plane.x > 0.0f ? node.Max.x : node.Min.x, plane.y > 0.0f ? node.Max.y : node.Min.y, plane.z > 0.0f ? node.Max.z : node.Min.z );
+                glm::vec3 negative( plane.x > 0.0f ? node.Min.x : node.Max.x, plane.y > 0.0f ? node.Min.y : node.Max.y, plane.z > 0.0f ? node.Min.z : node.Max.z );
+                if ( glm::dot( glm::vec3( plane ), positive ) + plane.w < 0.0f )
+                {
+                    outside = true;
+                }
+                else if ( glm::dot( glm::vec3( plane ), negative ) + plane.w >= 0.0f )
+                {
+                    planes &= ~( 1u << p );
+                }
+            }
+            if ( outside )
+            {
+                continue;
+            }
+
+            if ( 0 == planes || node.Count > 0 )
+            {
+                // Inside every plane, or a leaf: the primitives still have to pass the planes that were not settled
+                this->collect( node, frustum, planes, result );
+            }
+            else
+            {
+                stack[top++] = node.LeftFirst + 1;
+                stack[top++] = planes;
+                stack[top++] = node.LeftFirst;
+                stack[top++] = planes;
+            }
+        }
+    }
+
+    // Appends the ids of the primitives whose boxes overlap 'box'
+    void QueryBox( const AABB &box, std::vector<GLuint> &result ) const
+    {
+        if ( this->nodes.empty( ) )
+        {
+            return;
+        }
+
+        GLuint stack[STACK_SIZE];
+        GLuint top = 0;
+        stack[top++] = 0;
+        while ( top > 0 )
+        {
+            const BVHNode &node = this->nodes[stack[--top]];
+            if ( !box.Overlaps( AABB( node.Min, node.Max ) ) )
+            {
+                continue;
+            }
+
+            if ( node.Count > 0 )
+            {
+                for ( GLuint i = node.LeftFirst; i < node.LeftFirst + node.Count; i++ )
+                {
+                    if ( box.Overlaps( this->boxes[i] ) )
+                    {
+                        result.push_back( this->ids[i] );
+                    }
+                }
+            }
+            else
+            {
+                stack[top++] = node.LeftFirst + 1;
+                stack[top++] = node.LeftFirst;
+            }
+        }
+    }
+
+    // Finds the closest primitive box hit by the ray within 'distance'. On a hit returns true, sets 'primitive' to its id and
+    // 'distance' to the distance along 'direction' where the ray enters the box. The staircase quads are axis aligned, so for
+    // them the box is the quad itself.
+    bool Raycast( glm::vec3 origin, glm::vec3 direction, GLfloat &distance, GLuint &primitive ) const
+    {
+        if ( this->nodes.empty( ) )
+        {
+            return false;
+        }
+
+        // Division by a zero component gives an infinity, which the slab test handles
+        glm::vec3 inverse( 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z );
+        bool hit = false;
+
+        GLuint stack[STACK_SIZE];
+        GLuint top = 0;
+        if ( this->slab( this->nodes[0].Min, this->nodes[0].Max, origin, inverse, distance ) < distance )
+        {
+            stack[top++] = 0;
+        }
+        while ( top > 0 )
+        {
+            const BVHNode &node = this->nodes[stack[--top]];
+            if ( node.Count > 0 )
+            {
+                for ( GLuint i = node.LeftFirst; i < node.LeftFirst + node.Count; i++ )
+                {
+                    GLfloat entry = this->slab( this->boxes[i].Min, this->boxes[i].Max, origin, inverse, distance );
+                    if ( entry < distance )
+                    {
+                        distance = entry;
+                        primitive = this->ids[i];
+                        hit = true;
+                    }
+                }
+                continue;
+            }
+
+            // Visit the nearer child first, a hit in it usually rules the other one out
+            GLuint nearChild = node.LeftFirst, farChild = node.LeftFirst + 1;
+            GLfloat nearEntry = this->slab( this->nodes[nearChild].Min, this->nodes[nearChild].Max, origin, inverse, distance );
+            GLfloat farEntry = this->slab( this->nodes[farChild].Min, this->nodes[farChild].Max, origin, inverse, distance );
+            if ( farEntry < nearEntry )
+            {
+                std::swap( nearChild, farChild );
+                std::swap( nearEntry, farEntry );
+            }
+            if ( farEntry < distance )
+            {
+                stack[top++] = farChild;
+            }
+            if ( nearEntry < distance )
+            {
+                stack[top++] = nearChild;
+            }
+        }
+        return hit;
+    }
+
+private:
+    // Bins per axis the split candidates are evaluated on
+    static const GLuint BINS = 16;
+    // Leaves are never split below this many primitives
+    static const GLuint MIN_LEAF_SIZE = 2;
+    // Nodes this deep are left as leaves, which bounds the traversal stacks
+    static const GLuint MAX_DEPTH = 60;
+    static const GLuint STACK_SIZE = MAX_DEPTH + 2;
+
+    std::vector<BVHNode> nodes;
+    // Ids and boxes of the primitives in leaf order, so a leaf reads one contiguous run of them
+    std::vector<GLuint> ids;
+    std::vector<AABB> boxes;
+    // Box centers in leaf order, only kept while building
+    std::vector<glm::vec3> centers;
+
+    struct Bin
+    {
+        AABB bounds;
+        GLuint count;
+    };
+
+    // Splits a leaf along the cheapest binned plane if that beats keeping it, returns the index of the new left child or 0
+    GLuint split( GLuint index )
+    {
+        BVHNode node = this->nodes[index];
+        if ( node.Count <= MIN_LEAF_SIZE )
+        {
+            return 0;
+        }
+
+        // Bins span the centers rather than the boxes, big primitives would otherwise squeeze everything into a few bins
+        AABB centerBounds;
+        for ( GLuint i = node.LeftFirst; i < node.LeftFirst + node.Count; i++ )
+        {
+            centerBounds.Grow( this->centers[i] );
+        }
+
+        // All three axes are binned in the same pass over the primitives
+        Bin bins[3][BINS];
+        GLfloat scale[3];
+        for ( GLuint axis = 0; axis < 3; axis++ )
+        {
+            GLfloat extent = centerBounds.Max[axis] - centerBounds.Min[axis];
+            scale[axis] = ( extent > 0.0f ) ? BINS / extent : 0.0f;
+            for ( GLuint b = 0; b < BINS; b++ )
+            {
+                bins[axis][b].count = 0;
+            }
+        }
+        for ( GLuint i = node.LeftFirst; i < node.LeftFirst + node.Count; i++ )
+        {
+            for ( GLuint axis = 0; axis < 3; axis++ )
+            {
+                Bin &bin = bins[axis][this->bin( i, axis, centerBounds.Min[axis], scale[axis] )];
+                bin.count++;
+                bin.bounds.Grow( this->boxes[i] );
+            }
+        }
+
+        GLfloat bestCost = FLT_MAX;
+        GLuint bestAxis = 0, bestPlane = 0;
+        AABB bestLeft, bestRight;
+        for ( GLuint axis = 0; axis < 3; axis++ )
+        {
+            if ( 0.0f == scale[axis] )
+            {
+                continue;
+            }
+
+            // Sweep from both ends, plane p puts bins 0..p on the left
+            AABB leftBox[BINS - 1], rightBox[BINS - 1];
+            GLuint leftCount[BINS - 1], rightCount[BINS - 1];
+            AABB leftSweep, rightSweep;
+            GLuint leftSum = 0, rightSum = 0;
+            for ( GLuint p = 0; p < BINS - 1; p++ )
+            {
+                leftSum += bins[axis][p].count;
+                leftSweep.Grow( bins[axis][p].bounds );
+                leftCount[p] = leftSum;
+                leftBox[p] = leftSweep;
+
+                rightSum += bins[axis][BINS - 1 - p].count;
+                rightSweep.Grow( bins[axis][BINS - 1 - p].bounds );
+                rightCount[BINS - 2 - p] = rightSum;
+                rightBox[BINS - 2 - p] = rightSweep;
+            }
+            for ( GLuint p = 0; p < BINS - 1; p++ )
+            {
+                GLfloat cost = leftCount[p] * leftBox[p].HalfArea( ) + rightCount[p] * rightBox[p].HalfArea( );
+                if ( 0 != leftCount[p] && 0 != rightCount[p] && cost < bestCost )
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestPlane = p;
+                    bestLeft = leftBox[p];
+                    bestRight = rightBox[p];
+                }
+            }
+        }
+
+        // Keep the leaf when no split is cheaper than testing all of its primitives
+        if ( bestCost >= node.Count * AABB( node.Min, node.Max ).HalfArea( ) )
+        {
+            return 0;
+        }
+
+        // Partition the primitives in place, the left ones are those in bins up to the chosen plane
+        GLuint i = node.LeftFirst, j = node.LeftFirst + node.Count;
+        while ( i < j )
+        {
+            if ( this->bin( i, bestAxis, centerBounds.Min[bestAxis], scale[bestAxis] ) <= bestPlane )
+            {
+                i++;
+            }
+            else
+            {
+                j--;
+                std::swap( this->ids[i], this->ids[j] );
+                std::swap( this->centers[i], this->centers[j] );
+                std::swap( this->boxes[i], this->boxes[j] );
+            }
+        }
+
+        GLuint left = ( GLuint )this->nodes.size( );
+        BVHNode child;
+        child.Min = bestLeft.Min;
+        child.Max = bestLeft.Max;
+        child.LeftFirst = node.LeftFirst;
+        child.Count = i - node.LeftFirst;
+        this->nodes.push_back( child );
+        child.Min = bestRight.Min;
+        child.Max = bestRight.Max;
+        child.LeftFirst = i;
+        child.Count = node.LeftFirst + node.Count - i;
+        this->nodes.push_back( child );
+
+        this->nodes[index].LeftFirst = left;
+        this->nodes[index].Count = 0;
+        return left;
+    }
+
+    // Bin of a primitive along an axis, the same expression has to be used for binning and partitioning
+    GLuint bin( GLuint primitive, GLuint axis, GLfloat low, GLfloat scale ) const
+    {
+        return std::min( BINS - 1, ( GLuint )( ( this->centers[primitive][axis] - low ) * scale ) );
+    }
+
+    // Appends the primitives below a node that pass the frustum planes still set in 'planes'
+    void collect( const BVHNode &root, const Frustum &frustum, GLuint planes, std::vector<GLuint> &result ) const
+    {
+        // Subtrees are contiguous in leaf order, so the primitives below the node are the range from its leftmost leaf to
+        // its rightmost one
+        const BVHNode *first = &root, *last = &root;
+        while ( 0 == first->Count )
+        {
+            first = &this->nodes[first->LeftFirst];
+        }
+        while ( 0 == last->Count )
+        {
+            last = &this->nodes[last->LeftFirst + 1];
+        }
+
+        for ( GLuint i = first->LeftFirst; i < last->LeftFirst + last->Count; i++ )
+        {
+            if ( 0 == planes || this->inside( this->boxes[i], frustum, planes ) )
+            {
+                result.push_back( this->ids[i] );
+            }
+        }
+    }
+
+    bool inside( const AABB &box, const Frustum &frustum, GLuint planes ) const
+    {
+        for ( GLuint p = 0; p < 6; p++ )
+        {
+            if ( !( planes & ( 1u << p ) ) )
+            {
+                continue;
+            }
+
+            const glm::vec4 &plane = frustum.Planes[p];
+            glm::vec3 positive( plane.x > 0.0f ? box.Max.x : box.Min.x, plane.y > 0.0f ? box.Max.y : box.Min.y, plane.z > 0.0f ? box.Max.z : box.Min.z );
+            if ( glm::dot( glm::vec3( plane ), positive ) + plane.w < 0.0f )
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Distance at which the ray enters a box, FLT_MAX when it misses it or only reaches it past 'limit'
+    GLfloat slab( glm::vec3 min, glm::vec3 max, glm::vec3 origin, glm::vec3 inverse, GLfloat limit ) const
+    {
+        GLfloat entry = 0.0f, exit = limit;
+        for ( GLuint axis = 0; axis < 3; axis++ )
+        {
+            GLfloat t0 = ( min[axis] - origin[axis] ) * inverse[axis];
+            GLfloat t1 = ( max[axis] - origin[axis] ) * inverse[axis];
+            // A ray parallel to a slab and starting on its plane gives NaN here, the comparisons in min/max then keep the
+            // running entry and exit
+            entry = std::max( entry, std::min( t0, t1 ) );
+            exit = std::min( exit, std::max( t0, t1 ) );
+        }
+        return ( entry <= exit ) ? entry : FLT_MAX;
+    }
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Drives the game loop through a list of stages and times a fixed number of frames in each one.
+// Every frame is closed with glFinish so the measured time includes the GPU work of that frame.
+// Optionally one section of the frame is also timed on the GPU with a GL_TIME_ELAPSED query.
+class Benchmark
+{
+public:
+    Benchmark( ) : stage( 0 ), frame( 0 ), warmupFrames( 0 ), measuredFrames( 0 ), query( 0 ), gpuTimed( false )
+    {
+    }
+
+    // Frees the timer query, has to be called while the context is still alive
+    void Delete( )
+    {
+        if ( 0 != this->query )
+        {
+            glDeleteQueries( 1, &this->query );
+        }
+    }
+
+    // Starts a run, the first stage begins with the next frame
+    void Start( const std::string &title, const std::vector<std::string> &stages, GLuint warmupFrames = 30, GLuint measuredFrames = 200 )
+    {
+        this->title = title;
+        this->stages = stages;
+        this->warmupFrames = warmupFrames;
+        this->measuredFrames = measuredFrames;
+        this->stage = 0;
+        this->frame = 0;
+        this->samples.clear( );
+        this->results.clear( );
+    }
+
+    bool IsRunning( ) const
+    {
+        return this->stage < this->stages.size( );
+    }
+
+    bool IsFinished( ) const
+    {
+        return !this->stages.empty( ) && !this->IsRunning( );
+    }
+
+    // Index of the current stage
+    GLuint GetStage( ) const
+    {
+        return this->stage;
+    }
+
+    // True on the first frame of every stage, that's where the scene should be reconfigured for it
+    bool StageStarted( ) const
+    {
+        return this->IsRunning( ) && 0 == this->frame;
+    }
+
+    void BeginFrame( )
+    {
+        this->frameStart = std::chrono::steady_clock::now( );
+        this->gpuTimed = false;
+    }
+
+    // Starts timing a section of the frame on the GPU, e.g. the lit pass
+    void BeginGpuSection( )
+    {
+        if ( !this->IsRunning( ) )
+        {
+            return;
+        }
+
+        if ( 0 == this->query )
+        {
+            glGenQueries( 1, &this->query );
+        }
+        glBeginQuery( GL_TIME_ELAPSED, this->query );
+    }
+
+    void EndGpuSection( )
+    {
+        if ( !this->IsRunning( ) )
+        {
+            return;
+        }
+
+        glEndQuery( GL_TIME_ELAPSED );
+        this->gpuTimed = true;
+    }
+
+    // Waits for the GPU, records the frame and moves on to the next stage when this one has enough samples
+    void EndFrame( )
+    {
+        if ( !this->IsRunning( ) )
+        {
+            return;
+        }
+
+        glFinish( );
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now( ) - this->frameStart;
+
+        if ( this->frame >= this->warmupFrames )
+        {
+            this->samples.push_back( elapsed.count( ) );
+
+            // After glFinish the query result is ready, reading it doesn't stall anything
+            if ( this->gpuTimed )
+            {
+                GLuint64 nanoseconds;
+                glGetQueryObjectui64v( this->query, GL_QUERY_RESULT, &nanoseconds );
+                this->gpuSamples.push_back( nanoseconds / 1.0e6 );
+            }
+        }
+
+        if ( ++this->frame == this->warmupFrames + this->measuredFrames )
+        {
+            this->finishStage( );
+        }
+    }
+
+private:
+    struct Result
+    {
+        double average, median, minimum, maximum, gpuAverage;
+    };
+
+    std::string title;
+    std::vector<std::string> stages;
+    GLuint stage;
+    GLuint frame;
+    GLuint warmupFrames;
+    GLuint measuredFrames;
+    std::chrono::steady_clock::time_point frameStart;
+    std::vector<double> samples;
+    std::vector<double> gpuSamples;
+    std::vector<Result> results;
+    GLuint query;
+    bool gpuTimed;
+
+    void finishStage( )
+    {
+        std::sort( this->samples.begin( ), this->samples.end( ) );
+
+        Result result;
+        result.average = 0.0;
+        for ( size_t i = 0; i < this->samples.size( ); i++ )
+        {
+            result.average += this->samples[i];
+        }
+        result.average /= std::max<size_t>( this->samples.size( ), 1 );
+        result.median = this->samples.empty( ) ? 0.0 : this->samples[this->samples.size( ) / 2];
+        result.minimum = this->samples.empty( ) ? 0.0 : this->samples.front( );
+        result.maximum = this->samples.empty( ) ? 0.0 : this->samples.back( );
+        result.gpuAverage = 0.0;
+        for ( size_t i = 0; i < this->gpuSamples.size( ); i++ )
+        {
+            result.gpuAverage += this->gpuSamples[i] / this->gpuSamples.size( );
+        }
+        this->results.push_back( result );
+
+        this->samples.clear( );
+        this->gpuSamples.clear( );
+        this->frame = 0;
+
+        if ( ++this->stage == this->stages.size( ) )
+        {
+            this->print( );
+        }
+    }
+
+    void print( ) const
+    {
+        std::cout << "== " << this->title << " (" << this->measuredFrames << " frames per stage) ==" << std::endl;
+        std::cout << std::left << std::setw( 28 ) << "stage" << std::right
+                  << std::setw( 10 ) << "avg ms" << std::setw( 10 ) << "median" << std::setw( 10 ) << "min" << std::setw( 10 ) << "max" << std::setw( 12 ) << "gpu avg ms" << std::endl;
+        std::cout << std::fixed << std::setprecision( 3 );
+        for ( size_t i = 0; i < this->results.size( ); i++ )
+        {
+            std::cout << std::left << std::setw( 28 ) << this->stages[i] << std::right
+                      << std::setw( 10 ) << this->results[i].average
+                      << std::setw( 10 ) << this->results[i].median
+                      << std::setw( 10 ) << this->results[i].minimum
+                      << std::setw( 10 ) << this->results[i].maximum
+                      << std::setw( 12 ) << this->results[i].gpuAverage << std::endl;
+        }
+    }
+};
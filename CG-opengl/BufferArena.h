@@ -0,0 +1,349 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <iostream>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "GLState.h"
+
+// Bytes handed out by a TLSFAllocator
+struct BufferRange
+{
+    // Start of the data, aligned as requested
+    GLuint offset;
+    GLuint size;
+    // Block of the allocator the range lies in, it starts at or before offset
+    GLuint block;
+};
+
+// Two level segregated fit (TLSF) allocator of offsets into 'capacity' bytes. Free blocks are kept in lists by size class:
+// the first level is the power of two below the size, the second splits it in SECOND_LEVELS equal steps, and a bitmap per
+// level tells which lists have blocks. Allocating and freeing take a few bit scans and list operations however many blocks
+// there are, and a freed block is merged with the free blocks next to it right away, so free space never stays split into
+// pieces too small to use.
+class TLSFAllocator
+{
+public:
+    static const GLuint INVALID = 0xFFFFFFFF;
+
+    TLSFAllocator( ) : capacity( 0 ), freeBytes( 0 ), firstBitmap( 0 )
+    {
+    }
+
+    // Forgets every allocation and makes all of 'capacity' one free block
+    void Init( GLuint capacity )
+    {
+        this->capacity = capacity - capacity % GRANULARITY;
+        this->freeBytes = 0;
+        this->blocks.clear( );
+        this->unusedBlocks.clear( );
+        this->firstBitmap = 0;
+        for ( GLuint fl = 0; fl < FIRST_LEVELS; fl++ )
+        {
+            this->secondBitmaps[fl] = 0;
+            for ( GLuint sl = 0; sl < SECOND_LEVELS; sl++ )
+            {
+                this->heads[fl][sl] = INVALID;
+            }
+        }
+
+        if ( this->capacity > 0 )
+        {
+            Block block = { 0, this->capacity, INVALID, INVALID, INVALID, INVALID, true };
+            this->blocks.push_back( block );
+            this->insertFree( 0 );
+        }
+    }
+
+    // Allocates 'size' bytes starting at a multiple of 'alignment', false when no free block is large enough
+    bool Allocate( GLuint size, GLuint alignment, BufferRange &range )
+    {
+        // Blocks start on the granularity, alignments it isn't a multiple of need room to move the start
+        GLuint padding = ( 0 == GRANULARITY % alignment ) ? 0 : roundUp( alignment - 1 );
+        GLuint request = roundUp( ( size > 0 ? size : 1 ) + padding );
+        GLuint index = this->findFree( request );
+        if ( INVALID == index )
+        {
+            return false;
+        }
+
+        this->removeFree( index );
+        this->blocks[index].free = false;
+        if ( this->blocks[index].size - request >= GRANULARITY )
+        {
+            GLuint rest = this->newBlock( this->blocks[index].offset + request, this->blocks[index].size - request );
+            this->blocks[index].size = request;
+            this->blocks[rest].previous = index;
+            this->blocks[rest].next = this->blocks[index].next;
+            if ( INVALID != this->blocks[rest].next )
+            {
+                this->blocks[this->blocks[rest].next].previous = rest;
+            }
+            this->blocks[index].next = rest;
+            this->insertFree( rest );
+        }
+
+        range.offset = ( this->blocks[index].offset + alignment - 1 ) / alignment * alignment;
+        range.size = size;
+        range.block = index;
+        return true;
+    }
+
+    // Returns a range to the free lists, merged with the free blocks on either side of it
+    void Free( const BufferRange &range )
+    {
+        GLuint index = range.block;
+        this->blocks[index].free = true;
+
+        GLuint next = this->blocks[index].next;
+        if ( INVALID != next && this->blocks[next].free )
+        {
+            this->removeFree( next );
+            this->absorbNext( index );
+        }
+        GLuint previous = this->blocks[index].previous;
+        if ( INVALID != previous && this->blocks[previous].free )
+        {
+            this->removeFree( previous );
+            this->absorbNext( previous );
+            index = previous;
+        }
+        this->insertFree( index );
+    }
+
+    // Bytes the allocator hands out, rounded down to the granularity, and the ones of them in free blocks
+    GLuint GetCapacity( ) const
+    {
+        return this->capacity;
+    }
+
+    GLuint GetFreeBytes( ) const
+    {
+        return this->freeBytes;
+    }
+
+    // Number of blocks, free or not, a measure of how fragmented the range is
+    GLuint GetBlockCount( ) const
+    {
+        return ( GLuint )( this->blocks.size( ) - this->unusedBlocks.size( ) );
+    }
+
+private:
+    // Sizes are multiples of GRANULARITY bytes. Sizes below SMALL_SIZE have a list per granule in first level 0, larger ones
+    // SECOND_LEVELS lists per power of two.
+    static const GLuint GRANULARITY = 4;
+    static const GLuint SECOND_LEVEL_BITS = 4;
+    static const GLuint SECOND_LEVELS = 1 << SECOND_LEVEL_BITS;
+    static const GLuint SMALL_SIZE_BITS = 6;
+    static const GLuint SMALL_SIZE = 1 << SMALL_SIZE_BITS;
+    static const GLuint FIRST_LEVELS = 32 - SMALL_SIZE_BITS + 1;
+
+    struct Block
+    {
+        GLuint offset;
+        GLuint size;
+        // Neighbours in the range
+        GLuint previous;
+        GLuint next;
+        // Neighbours in the free list, when free
+        GLuint previousFree;
+        GLuint nextFree;
+        bool free;
+    };
+
+    GLuint capacity;
+    GLuint freeBytes;
+    std::vector<Block> blocks;
+    // Entries of blocks merged away, reused before blocks grows
+    std::vector<GLuint> unusedBlocks;
+    GLuint firstBitmap;
+    GLuint secondBitmaps[FIRST_LEVELS];
+    GLuint heads[FIRST_LEVELS][SECOND_LEVELS];
+
+    static GLuint roundUp( GLuint size )
+    {
+        return ( size + GRANULARITY - 1 ) / GRANULARITY * GRANULARITY;
+    }
+
+    static GLuint highestBit( GLuint value )
+    {
+        return 31 - __builtin_clz( value );
+    }
+
+    static GLuint lowestBit( GLuint value )
+    {
+        return __builtin_ctz( value );
+    }
+
+    // Lists a block of 'size' bytes belongs in
+    static void mapping( GLuint size, GLuint &fl, GLuint &sl )
+    {
+        if ( size < SMALL_SIZE )
+        {
+            fl = 0;
+            sl = size / ( SMALL_SIZE / SECOND_LEVELS );
+        }
+        else
+        {
+            GLuint top = highestBit( size );
+            sl = ( size >> ( top - SECOND_LEVEL_BITS ) ) - SECOND_LEVELS;
+            fl = top - SMALL_SIZE_BITS + 1;
+        }
+    }
+
+    // A free block of at least 'size' bytes. The size is rounded up to the next list first, so any block of the list found
+    // is large enough and the search never walks a list.
+    GLuint findFree( GLuint size ) const
+    {
+        if ( size >= SMALL_SIZE )
+        {
+            size += ( 1u << ( highestBit( size ) - SECOND_LEVEL_BITS ) ) - 1;
+        }
+        GLuint fl, sl;
+        mapping( size, fl, sl );
+        if ( fl >= FIRST_LEVELS )
+        {
+            return INVALID;
+        }
+
+        GLuint secondMap = this->secondBitmaps[fl] & ( ~0u << sl );
+        if ( 0 == secondMap )
+        {
+            GLuint firstMap = ( fl + 1 < 32 ) ? this->firstBitmap & ( ~0u << ( fl + 1 ) ) : 0;
+            if ( 0 == firstMap )
+            {
+                return INVALID;
+            }
+            fl = lowestBit( firstMap );
+            secondMap = this->secondBitmaps[fl];
+        }
+        return this->heads[fl][lowestBit( secondMap )];
+    }
+
+    void insertFree( GLuint index )
+    {
+        Block &block = this->blocks[index];
+        GLuint fl, sl;
+        mapping( block.size, fl, sl );
+        block.free = true;
+        block.previousFree = INVALID;
+        block.nextFree = this->heads[fl][sl];
+        if ( INVALID != block.nextFree )
+        {
+            this->blocks[block.nextFree].previousFree = index;
+        }
+        this->heads[fl][sl] = index;
+        this->firstBitmap |= 1u << fl;
+        this->secondBitmaps[fl] |= 1u << sl;
+        this->freeBytes += block.size;
+    }
+
+    void removeFree( GLuint index )
+    {
+        Block &block = this->blocks[index];
+        GLuint fl, sl;
+        mapping( block.size, fl, sl );
+        if ( INVALID != block.previousFree )
+        {
+            this->blocks[block.previousFree].nextFree = block.nextFree;
+        }
+        else
+        {
+            this->heads[fl][sl] = block.nextFree;
+        }
+        if ( INVALID != block.nextFree )
+        {
+            this->blocks[block.nextFree].previousFree = block.previousFree;
+        }
+        if ( INVALID == this->heads[fl][sl] )
+        {
+            this->secondBitmaps[fl] &= ~( 1u << sl );
+            if ( 0 == this->secondBitmaps[fl] )
+            {
+                this->firstBitmap &= ~( 1u << fl );
+            }
+        }
+        this->freeBytes -= block.size;
+    }
+
+    GLuint newBlock( GLuint offset, GLuint size )
+    {
+        Block block = { offset, size, INVALID, INVALID, INVALID, INVALID, true };
+        if ( this->unusedBlocks.empty( ) )
+        {
+            this->blocks.push_back( block );
+            return ( GLuint )this->blocks.size( ) - 1;
+        }
+        GLuint index = this->unusedBlocks.back( );
+        this->unusedBlocks.pop_back( );
+        this->blocks[index] = block;
+        return index;
+    }
+
+    // Merges the block after 'index' into it, neither may be in a free list
+    void absorbNext( GLuint index )
+    {
+        GLuint next = this->blocks[index].next;
+        this->blocks[index].size += this->blocks[next].size;
+        this->blocks[index].next = this->blocks[next].next;
+        if ( INVALID != this->blocks[index].next )
+        {
+            this->blocks[this->blocks[index].next].previous = index;
+        }
+        this->unusedBlocks.push_back( next );
+    }
+};
+
+// One GL buffer the meshes of the application share, each in a range a TLSFAllocator hands out. With a single buffer for the
+// vertices and one for the indices, VAOs of the same vertex format differ only in their instance buffers and a mesh is created
+// with a glBufferSubData and a few list operations instead of glGenBuffers and glBufferData.
+class BufferArena
+{
+public:
+    BufferArena( ) : buffer( 0 )
+    {
+    }
+
+    // Creates the buffer with room for 'capacity' bytes
+    void Create( GLuint capacity )
+    {
+        glGenBuffers( 1, &this->buffer );
+        // Written through the copy target, so no VAO's element buffer binding is touched
+        GLState::Get( ).BindBuffer( GL_COPY_WRITE_BUFFER, this->buffer );
+        glBufferData( GL_COPY_WRITE_BUFFER, capacity, NULL, GL_DYNAMIC_DRAW );
+        this->allocator.Init( capacity );
+    }
+
+    // Copies 'size' bytes into a new range starting at a multiple of 'alignment'. A full arena returns an empty range.
+    BufferRange Upload( const GLvoid *data, GLuint size, GLuint alignment )
+    {
+        BufferRange range = { 0, 0, TLSFAllocator::INVALID };
+        if ( !this->allocator.Allocate( size, alignment, range ) )
+        {
+            std::cout << "ERROR::BUFFER_ARENA::OUT_OF_MEMORY " << size << " bytes" << std::endl;
+            return range;
+        }
+        GLState::Get( ).BindBuffer( GL_COPY_WRITE_BUFFER, this->buffer );
+        glBufferSubData( GL_COPY_WRITE_BUFFER, range.offset, size, data );
+        return range;
+    }
+
+    GLuint GetBuffer( ) const
+    {
+        return this->buffer;
+    }
+
+    void Delete( )
+    {
+        glDeleteBuffers( 1, &this->buffer );
+        this->buffer = 0;
+    }
+
+private:
+    GLuint buffer;
+    TLSFAllocator allocator;
+};
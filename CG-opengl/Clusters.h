@@ -0,0 +1,282 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "Lights.h"
+
+// Size of the cluster grid the view frustum is split into: 16x9 screen tiles and 24 exponential depth slices.
+// Has to match the CLUSTER_* defines in lighting.frag
+const GLuint CLUSTER_X = 16;
+const GLuint CLUSTER_Y = 9;
+const GLuint CLUSTER_Z = 24;
+const GLuint CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+// Texture units of the cluster buffers, 0 and 1 hold the material maps and POINT_LIGHT_UNIT the lights themselves
+const GLuint CLUSTER_GRID_UNIT = 2;
+const GLuint CLUSTER_INDEX_UNIT = 3;
+
+constexpr GLuint UNIFORM_CLUSTER_GRID = UniformHash( "clusterGrid" );
+constexpr GLuint UNIFORM_CLUSTER_LIGHT_INDICES = UniformHash( "clusterLightIndices" );
+constexpr GLuint UNIFORM_POINT_LIGHT_DATA = UniformHash( "pointLightData" );
+constexpr GLuint UNIFORM_CLUSTER_TILE_SIZE = UniformHash( "clusterTileSize" );
+constexpr GLuint UNIFORM_CLUSTER_Z_PARAMS = UniformHash( "clusterZParams" );
+
+// Distance at which a point light's attenuation drops below 5/256 of its brightest channel, past that it can't change an 8 bit pixel
+inline GLfloat LightRadius( const PointLightData &light )
+{
+    glm::vec3 brightest = glm::max( light.ambient, glm::max( light.diffuse, light.specular ) );
+    GLfloat threshold = std::max( std::max( brightest.x, brightest.y ), brightest.z ) * 256.0f / 5.0f;
+
+    if ( light.constant >= threshold )
+    {
+        return 0.0f;
+    }
+
+    // Solve constant + linear * d + quadratic * d^2 = threshold
+    if ( light.quadratic > 0.0f )
+    {
+        return ( -light.linear + std::sqrt( light.linear * light.linear - 4.0f * light.quadratic * ( light.constant - threshold ) ) ) / ( 2.0f * light.quadratic );
+    }
+
+    if ( light.linear > 0.0f )
+    {
+        return ( threshold - light.constant ) / light.linear;
+    }
+
+    return std::numeric_limits<GLfloat>::max( );
+}
+
+// Clustered forward lighting. Every frame the CPU assigns each point light to the clusters its sphere of influence touches,
+// and the fragment shader only loops over the lights of its own cluster. The grid reaches the shader through two texture buffers:
+//   clusterGrid          RG32UI   (first index, light count) per cluster
+//   clusterLightIndices  R32UI    light indices of all clusters back to back
+// The indices point into the PointLightBuffer bound at POINT_LIGHT_UNIT.
+class ClusterGrid
+{
+public:
+    ClusterGrid( ) : indexCount( 0 )
+    {
+        glGenBuffers( 2, this->buffers );
+        glGenTextures( 2, this->textures );
+
+        const GLenum formats[2] = { GL_RG32UI, GL_R32UI };
+        for ( GLuint i = 0; i < 2; i++ )
+        {
+            GLState::Get( ).BindBuffer( GL_TEXTURE_BUFFER, this->buffers[i] );
+            glBufferData( GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW );
+            GLState::Get( ).BindTexture( 0, GL_TEXTURE_BUFFER, this->textures[i] );
+            glTexBuffer( GL_TEXTURE_BUFFER, formats[i], this->buffers[i] );
+        }
+        GLState::Get( ).BindTexture( 0, GL_TEXTURE_BUFFER, 0 );
+    }
+
+    // Frees the buffers, has to be called while the context is still alive
+    void Delete( )
+    {
+        glDeleteTextures( 2, this->textures );
+        glDeleteBuffers( 2, this->buffers );
+    }
+
+    // Caches the position and radius of each light, only needed when lights are added, removed or edited
+    void SetLights( const std::vector<PointLightData> &lights )
+    {
+        this->positions.resize( lights.size( ) );
+        this->radii.resize( lights.size( ) );
+        for ( size_t i = 0; i < lights.size( ); i++ )
+        {
+            this->positions[i] = lights[i].position;
+            this->radii[i] = LightRadius( lights[i] );
+        }
+    }
+
+    // Assigns every light to the clusters its sphere of influence overlaps and uploads the grid and the index list
+    void Build( const glm::mat4 &view, const glm::mat4 &projection, GLfloat nearPlane, GLfloat farPlane )
+    {
+        GLfloat sliceScale = CLUSTER_Z / std::log( farPlane / nearPlane );
+
+        this->grid.assign( 2 * CLUSTER_COUNT, 0 );
+        this->lightRanges.clear( );
+
+        // 1. Find the cluster range of every light and count how many lights land in each cluster
+        for ( GLuint i = 0; i < this->positions.size( ); i++ )
+        {
+            glm::vec3 center = glm::vec3( view * glm::vec4( this->positions[i], 1.0f ) );
+            GLfloat radius = this->radii[i];
+            GLfloat depth = -center.z;
+
+            if ( depth + radius < nearPlane || depth - radius > farPlane )
+            {
+                continue;
+            }
+
+            // Depth slices are exponential, the same mapping the fragment shader uses
+            GLint z0 = this->slice( std::max( depth - radius, nearPlane ), nearPlane, sliceScale );
+            GLint z1 = this->slice( std::min( depth + radius, farPlane ), nearPlane, sliceScale );
+
+            // Screen tiles come from the projected corners of the sphere's view space box, once the box crosses the near plane it may cover anything
+            glm::vec2 ndcMin( -1.0f ), ndcMax( 1.0f );
+            if ( depth - radius > nearPlane )
+            {
+                ndcMin = glm::vec2( std::numeric_limits<GLfloat>::max( ) );
+                ndcMax = glm::vec2( -std::numeric_limits<GLfloat>::max( ) );
+                for ( GLuint corner = 0; corner < 8; corner++ )
+                {
+                    glm::vec3 offset( ( corner & 1 ) ? radius : -radius, ( corner & 2 ) ? radius : -radius, ( corner & 4 ) ? radius : -radius );
+                    glm::vec4 clip = projection * glm::vec4( center + offset, 1.0f );
+                    ndcMin.x = std::min( ndcMin.x, clip.x / clip.w );
+                    ndcMin.y = std::min( ndcMin.y, clip.y / clip.w );
+                    ndcMax.x = std::max( ndcMax.x, clip.x / clip.w );
+                    ndcMax.y = std::max( ndcMax.y, clip.y / clip.w );
+                }
+
+                if ( ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f )
+                {
+                    continue;
+                }
+            }
+
+            LightRange range;
+            range.light = i;
+            range.x0 = this->tile( ndcMin.x, CLUSTER_X );
+            range.x1 = this->tile( ndcMax.x, CLUSTER_X );
+            range.y0 = this->tile( ndcMin.y, CLUSTER_Y );
+            range.y1 = this->tile( ndcMax.y, CLUSTER_Y );
+            range.z0 = z0;
+            range.z1 = z1;
+            this->lightRanges.push_back( range );
+
+            for ( GLint z = range.z0; z <= range.z1; z++ )
+            {
+                for ( GLint y = range.y0; y <= range.y1; y++ )
+                {
+                    for ( GLint x = range.x0; x <= range.x1; x++ )
+                    {
+                        this->grid[2 * this->cluster( x, y, z ) + 1]++;
+                    }
+                }
+            }
+        }
+
+        // 2. Prefix sum of the counts gives every cluster its first slot in the index list
+        GLuint offset = 0;
+        for ( GLuint c = 0; c < CLUSTER_COUNT; c++ )
+        {
+            this->grid[2 * c] = offset;
+            offset += this->grid[2 * c + 1];
+        }
+        this->indexCount = offset;
+
+        // 3. Scatter the light indices into their clusters
+        this->indices.resize( std::max<GLuint>( offset, 1 ) );
+        this->cursor.resize( CLUSTER_COUNT );
+        for ( GLuint c = 0; c < CLUSTER_COUNT; c++ )
+        {
+            this->cursor[c] = this->grid[2 * c];
+        }
+        for ( size_t r = 0; r < this->lightRanges.size( ); r++ )
+        {
+            const LightRange &range = this->lightRanges[r];
+            for ( GLint z = range.z0; z <= range.z1; z++ )
+            {
+                for ( GLint y = range.y0; y <= range.y1; y++ )
+                {
+                    for ( GLint x = range.x0; x <= range.x1; x++ )
+                    {
+                        this->indices[this->cursor[this->cluster( x, y, z )]++] = range.light;
+                    }
+                }
+            }
+        }
+
+        this->upload( GRID, this->grid.size( ) * sizeof( GLuint ), this->grid.data( ) );
+        this->upload( INDICES, this->indices.size( ) * sizeof( GLuint ), this->indices.data( ) );
+    }
+
+    // Binds the two texture buffers to their texture units
+    void Bind( )
+    {
+        const GLuint units[2] = { CLUSTER_GRID_UNIT, CLUSTER_INDEX_UNIT };
+        for ( GLuint i = 0; i < 2; i++ )
+        {
+            GLState::Get( ).BindTexture( units[i], GL_TEXTURE_BUFFER, this->textures[i] );
+        }
+    }
+
+    // Points the samplers of a clustered shader at our texture units, only needed once per program
+    static void SetSamplers( Shader &shader )
+    {
+        shader.Use( );
+        shader.SetInt( UNIFORM_CLUSTER_GRID, CLUSTER_GRID_UNIT );
+        shader.SetInt( UNIFORM_CLUSTER_LIGHT_INDICES, CLUSTER_INDEX_UNIT );
+        shader.SetInt( UNIFORM_POINT_LIGHT_DATA, POINT_LIGHT_UNIT );
+    }
+
+    // Sets what the fragment shader needs to find its own cluster, the shader has to be in use
+    static void SetUniforms( Shader &shader, GLint screenWidth, GLint screenHeight, GLfloat nearPlane, GLfloat farPlane )
+    {
+        GLfloat sliceScale = CLUSTER_Z / std::log( farPlane / nearPlane );
+        shader.SetVec2( UNIFORM_CLUSTER_TILE_SIZE, glm::vec2( ( GLfloat )screenWidth / CLUSTER_X, ( GLfloat )screenHeight / CLUSTER_Y ) );
+        shader.SetVec4( UNIFORM_CLUSTER_Z_PARAMS, glm::vec4( nearPlane, farPlane, sliceScale, -sliceScale * std::log( nearPlane ) ) );
+    }
+
+    // Total number of light references in the last built grid
+    GLuint GetIndexCount( ) const
+    {
+        return this->indexCount;
+    }
+
+private:
+    enum { GRID, INDICES };
+
+    struct LightRange
+    {
+        GLuint light;
+        GLint x0, x1, y0, y1, z0, z1;
+    };
+
+    GLuint buffers[2];
+    GLuint textures[2];
+    GLuint indexCount;
+
+    std::vector<glm::vec3> positions;
+    std::vector<GLfloat> radii;
+    std::vector<LightRange> lightRanges;
+    std::vector<GLuint> grid;
+    std::vector<GLuint> indices;
+    std::vector<GLuint> cursor;
+
+    GLuint cluster( GLint x, GLint y, GLint z ) const
+    {
+        return ( GLuint )( x + CLUSTER_X * ( y + CLUSTER_Y * z ) );
+    }
+
+    GLint slice( GLfloat depth, GLfloat nearPlane, GLfloat sliceScale ) const
+    {
+        GLint k = ( GLint )std::floor( std::log( depth / nearPlane ) * sliceScale );
+        return std::min( std::max( k, 0 ), ( GLint )CLUSTER_Z - 1 );
+    }
+
+    GLint tile( GLfloat ndc, GLuint tiles ) const
+    {
+        GLint t = ( GLint )std::floor( ( ndc * 0.5f + 0.5f ) * tiles );
+        return std::min( std::max( t, 0 ), ( GLint )tiles - 1 );
+    }
+
+    // Re-specifies a buffer every time so the driver can hand us fresh storage instead of waiting on the GPU
+    void upload( GLuint buffer, size_t size, const GLvoid *data )
+    {
+        GLState::Get( ).BindBuffer( GL_TEXTURE_BUFFER, this->buffers[buffer] );
+        glBufferData( GL_TEXTURE_BUFFER, std::max<size_t>( size, 16 ), ( size > 0 ) ? data : NULL, GL_STREAM_DRAW );
+    }
+};
@@ -0,0 +1,477 @@
+#pragma once
+
+// Std. Includes
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+
+#if defined( __AVX__ )
+#include <immintrin.h>
+#elif defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Lane type of the cube kernel, like TransformLanes: 8 cubes per instruction with AVX, 4 with SSE, one without either.
+// Comparisons return masks that Or and MoveMask take.
+#if defined( __AVX__ )
+struct CubeLanes
+{
+    typedef __m256 Type;
+    static const size_t WIDTH = 8;
+
+    static Type Load( const GLfloat *p ) { return _mm256_loadu_ps( p ); }
+    static void Store( GLfloat *p, Type a ) { _mm256_storeu_ps( p, a ); }
+    static Type Set( GLfloat v ) { return _mm256_set1_ps( v ); }
+    static Type Add( Type a, Type b ) { return _mm256_add_ps( a, b ); }
+    static Type Sub( Type a, Type b ) { return _mm256_sub_ps( a, b ); }
+    static Type Mul( Type a, Type b ) { return _mm256_mul_ps( a, b ); }
+    static Type Less( Type a, Type b ) { return _mm256_cmp_ps( a, b, _CMP_LT_OQ ); }
+    static Type LessEqual( Type a, Type b ) { return _mm256_cmp_ps( a, b, _CMP_LE_OQ ); }
+    static Type Or( Type a, Type b ) { return _mm256_or_ps( a, b ); }
+    static GLuint MoveMask( Type mask ) { return ( GLuint )_mm256_movemask_ps( mask ); }
+};
+#elif defined( __SSE2__ )
+struct CubeLanes
+{
+    typedef __m128 Type;
+    static const size_t WIDTH = 4;
+
+    static Type Load( const GLfloat *p ) { return _mm_loadu_ps( p ); }
+    static void Store( GLfloat *p, Type a ) { _mm_storeu_ps( p, a ); }
+    static Type Set( GLfloat v ) { return _mm_set1_ps( v ); }
+    static Type Add( Type a, Type b ) { return _mm_add_ps( a, b ); }
+    static Type Sub( Type a, Type b ) { return _mm_sub_ps( a, b ); }
+    static Type Mul( Type a, Type b ) { return _mm_mul_ps( a, b ); }
+    static Type Less( Type a, Type b ) { return _mm_cmplt_ps( a, b ); }
+    static Type LessEqual( Type a, Type b ) { return _mm_cmple_ps( a, b ); }
+    static Type Or( Type a, Type b ) { return _mm_or_ps( a, b ); }
+    static GLuint MoveMask( Type mask ) { return ( GLuint )_mm_movemask_ps( mask ); }
+};
+#else
+struct CubeLanes
+{
+    // Masks are floats with all bits set or clear, like the SIMD ones
+    typedef GLfloat Type;
+    static const size_t WIDTH = 1;
+
+    static Type Load( const GLfloat *p ) { return *p; }
+    static void Store( GLfloat *p, Type a ) { *p = a; }
+    static Type Set( GLfloat v ) { return v; }
+    static Type Add( Type a, Type b ) { return a + b; }
+    static Type Sub( Type a, Type b ) { return a - b; }
+    static Type Mul( Type a, Type b ) { return a * b; }
+    static Type Less( Type a, Type b ) { return mask( a < b ); }
+    static Type LessEqual( Type a, Type b ) { return mask( a <= b ); }
+    static Type Or( Type a, Type b ) { return fromBits( bits( a ) | bits( b ) ); }
+    static GLuint MoveMask( Type mask ) { return bits( mask ) >> 31; }
+
+private:
+    static Type mask( bool set ) { return fromBits( set ? 0xFFFFFFFFu : 0u ); }
+    static uint32_t bits( Type a ) { uint32_t b; std::memcpy( &b, &a, sizeof( b ) ); return b; }
+    static Type fromBits( uint32_t b ) { Type a; std::memcpy( &a, &b, sizeof( a ) ); return a; }
+};
+#endif
+
+// The falling cubes of the game. A cube drops from the sky, bounces down the staircase while drifting towards the camera
+// (along +z), then starts over at a random place high over the top of the flight, allowed two bounces fewer each time.
+//
+// Nothing is integrated: every part of a cube's path is in closed form. It drifts at a constant speed, drops onto the step
+// under it in DROP_TIME, then bounces in parabolas that each last RESTITUTION times as long as the one before and land on the
+// step under the cube when they end. The start of bounce k is then a geometric series, and the bounce a cube is in at any
+// time is found with a logarithm instead of by stepping through the ones before it. How long a life lasts only depends on
+// its number, so the life a cube is on is found from a table of the first few life starts, and from a division once lives
+// have no bounces left. Where a cube starts over comes from a hash of its seed and the number of the life, so its whole
+// path follows from where and when it was added: GetPositionAt evaluates it at any time in constant time, backwards too,
+// without reading or writing any state, and replays the same whatever the frame rate.
+//
+// GetBounds gives a box around where a cube goes over a short time, so the cubes can be culled before any of them is moved
+// and only the visible ones evaluated. SetTime is a fast path for moving every cube at once: it caches the parabola every
+// cube is on in separate arrays (structure of arrays) and evaluates several cubes per instruction, only a cube that has left
+// its parabola has it looked up again.
+class CubeSimulation
+{
+public:
+    // Cubes bouncing down the staircase Staircase::Generate builds from 'steps', 'rise', 'run' and 'width', placed at 'origin'
+    CubeSimulation( glm::vec3 origin, GLuint steps, GLfloat rise, GLfloat run, GLfloat width )
+        : origin( origin ), steps( steps ), rise( rise ), run( run ), width( width ), count( 0 ), arcChanges( 0 )
+    {
+        for ( GLint bounce = 0; bounce <= START_BOUNCES; bounce++ )
+        {
+            this->series[bounce] = FIRST_BOUNCE * ( 1.0f - std::pow( RESTITUTION, ( GLfloat )bounce ) ) / ( 1.0f - RESTITUTION );
+        }
+        this->lifeStarts[0] = 0.0f;
+        for ( GLuint life = 1; life <= LAST_LIFE; life++ )
+        {
+            this->lifeStarts[life] = this->lifeStarts[life - 1] + DROP_TIME + this->series[maxBounces( life - 1 )];
+        }
+    }
+
+    // Adds a cube that drops from 'time' on and returns its index. 'seed' picks where it starts and starts over.
+    GLuint Add( GLfloat time, GLuint seed )
+    {
+        GLuint index = this->count++;
+        size_t padded = ( this->count + L::WIDTH - 1 ) / L::WIDTH * L::WIDTH;
+        std::vector<GLfloat> *arrays[ARRAYS] = { &this->x, &this->y, &this->z, &this->startTime, &this->startZ,
+                                                 &this->arcStart, &this->arcEnd, &this->arcHeight, &this->arcVelocity };
+        for ( GLuint i = 0; i < ARRAYS; i++ )
+        {
+            // Padding lanes are on a parabola that never ends
+            arrays[i]->resize( padded, ( arrays[i] == &this->arcEnd ) ? HUGE_VALF : 0.0f );
+        }
+        this->firstLives.push_back( this->lifeOf( seed, 0, time ) );
+        this->seeds.push_back( seed );
+        this->cachedBounces.push_back( NO_BOUNCE );
+
+        this->cacheArc( index, time );
+        glm::vec3 start = this->GetPositionAt( index, time );
+        this->y[index] = start.y;
+        this->z[index] = start.z;
+        return index;
+    }
+
+    // Fast path, moves every cube to where it is at 'time', which may be before the last one
+    void SetTime( GLfloat time )
+    {
+        this->SetTime( time, 0, this->count );
+    }
+
+    // Moves the cubes [first, last) only, 'first' a multiple of the lane width. Ranges that don't overlap can be moved on
+    // threads of their own.
+    void SetTime( GLfloat time, size_t first, size_t last )
+    {
+        const L::Type t = L::Set( time );
+        const L::Type halfGravity = L::Set( 0.5f * GRAVITY ), drift = L::Set( DRIFT );
+
+        // The arrays are padded to a whole number of lanes, the padding lanes are evaluated too and never read
+        for ( size_t i = first; i < last; i += L::WIDTH )
+        {
+            // Cubes that are not on their cached parabola at 'time' look up the one they are on
+            L::Type arcStart = L::Load( &this->arcStart[i] );
+            GLuint left = L::MoveMask( L::Or( L::Less( t, arcStart ), L::LessEqual( L::Load( &this->arcEnd[i] ), t ) ) );
+            for ( GLuint lane = 0; 0 != left && lane < L::WIDTH && i + lane < last; lane++ )
+            {
+                if ( left & ( 1u << lane ) )
+                {
+                    this->cacheArc( ( GLuint )( i + lane ), time );
+                }
+            }
+            if ( 0 != left )
+            {
+                arcStart = L::Load( &this->arcStart[i] );
+            }
+
+            L::Type arcTime = L::Sub( t, arcStart );
+            L::Type climb = L::Sub( L::Load( &this->arcVelocity[i] ), L::Mul( halfGravity, arcTime ) );
+            L::Store( &this->y[i], L::Add( L::Load( &this->arcHeight[i] ), L::Mul( climb, arcTime ) ) );
+            L::Type lifeTime = L::Sub( t, L::Load( &this->startTime[i] ) );
+            L::Store( &this->z[i], L::Add( L::Load( &this->startZ[i] ), L::Mul( drift, lifeTime ) ) );
+        }
+    }
+
+    GLuint GetCount( ) const
+    {
+        return this->count;
+    }
+
+    // Where the cube was at the last SetTime
+    glm::vec3 GetPosition( GLuint i ) const
+    {
+        return glm::vec3( this->x[i], this->y[i], this->z[i] );
+    }
+
+    // Where the cube is at any 'time', without touching the cache
+    glm::vec3 GetPositionAt( GLuint i, GLfloat time ) const
+    {
+        Life life;
+        Arc arc;
+        this->locate( i, time, NO_BOUNCE, life, arc );
+        return evaluate( life, arc, time );
+    }
+
+    // Box around the center of the cube from 'from' to 'to', a few parabolas at most for the fraction of a second it's meant
+    // for. Every parabola on the way adds where the cube is at its ends and at its top, when that is on the way too.
+    void GetBounds( GLuint i, GLfloat from, GLfloat to, glm::vec3 &min, glm::vec3 &max ) const
+    {
+        min = glm::vec3( FLT_MAX );
+        max = glm::vec3( -FLT_MAX );
+        GLfloat time = from;
+        do
+        {
+            Life life;
+            Arc arc;
+            this->locate( i, time, NO_BOUNCE, life, arc );
+            GLfloat end = std::min( arc.end, to );
+            GLfloat top = arc.start + arc.velocity / GRAVITY;
+            GLfloat times[3] = { time, end, std::min( std::max( top, time ), end ) };
+            for ( GLuint j = 0; j < 3; j++ )
+            {
+                glm::vec3 position = evaluate( life, arc, times[j] );
+                min = glm::min( min, position );
+                max = glm::max( max, position );
+            }
+            // Where rounding puts the end of a parabola back on it, the next one is looked up just after
+            time = ( arc.end > time ) ? arc.end : std::nextafter( time, HUGE_VALF );
+        }
+        while ( time < to );
+
+        // Rounding can start the next life a little before the end of the last parabola of the one before
+        glm::vec3 last = this->GetPositionAt( i, to );
+        min = glm::min( min, last );
+        max = glm::max( max, last );
+    }
+
+    // Parabolas looked up by SetTime since the start, the only work it does one cube at a time
+    GLuint GetArcChanges( ) const
+    {
+        return this->arcChanges.load( std::memory_order_relaxed );
+    }
+
+private:
+    typedef CubeLanes L;
+
+    static const GLuint ARRAYS = 9;
+    // Bounces before the first restart, and how many fewer every restart allows, down to none from LAST_LIFE on
+    static const GLint START_BOUNCES = 30;
+    static const GLint BOUNCE_LOSS = 2;
+    static const GLuint LAST_LIFE = ( START_BOUNCES + BOUNCE_LOSS - 1 ) / BOUNCE_LOSS;
+    // Bounce of the drop, and of no cached parabola
+    enum { DROP = -1, NO_BOUNCE = -2 };
+    // Units per second squared, and the drift towards the camera in units per second
+    static constexpr GLfloat GRAVITY = 20.0f;
+    static constexpr GLfloat DRIFT = 3.0f;
+    // Seconds from the start of a life to the first landing, whatever the height, tossing cubes up a little that start low
+    static constexpr GLfloat DROP_TIME = 0.5f;
+    // Seconds the first bounce lasts, and how much shorter every bounce is than the one before
+    static constexpr GLfloat FIRST_BOUNCE = 0.6f;
+    static constexpr GLfloat RESTITUTION = 0.95f;
+    // How high over a tread a cube lands
+    static constexpr GLfloat FLOOR_REST = 0.1f;
+    // Cubes start over RESTART_HEIGHT over the top tread, at most RESTART_DEPTH into the flight from its far end and at least
+    // RESTART_INSET from the walls, and drop at least MIN_DROP onto the step under them
+    static constexpr GLfloat RESTART_HEIGHT = 3.0f;
+    static constexpr GLfloat RESTART_DEPTH = 20.0f;
+    static constexpr GLfloat RESTART_INSET = 1.0f;
+    static constexpr GLfloat MIN_DROP = 1.0f;
+
+    // One run of a cube from its drop to starting over
+    struct Life
+    {
+        GLuint number;
+        GLfloat start;
+        glm::vec3 position;
+    };
+
+    // The parabola y = height + velocity * t - gravity * t^2 / 2 from 'start' to 'end', t counted from 'start'
+    struct Arc
+    {
+        GLint bounce;
+        GLfloat start;
+        GLfloat end;
+        GLfloat height;
+        GLfloat velocity;
+    };
+
+    // The staircase, as Staircase::Generate takes it
+    glm::vec3 origin;
+    GLuint steps;
+    GLfloat rise;
+    GLfloat run;
+    GLfloat width;
+    GLuint count;
+    std::atomic<GLuint> arcChanges;
+    // What SetTime caches: where the cubes are, the start of their life, its x never changes and lives in x, and the
+    // parabola they are on with its bounce
+    std::vector<GLfloat> x, y, z;
+    std::vector<GLfloat> startTime, startZ;
+    std::vector<GLfloat> arcStart, arcEnd, arcHeight, arcVelocity;
+    std::vector<GLint> cachedBounces;
+    // The life every cube was added with, the path is looked up from it
+    std::vector<Life> firstLives;
+    std::vector<GLuint> seeds;
+    // Time from the end of the drop to the start of every bounce, and from the start of the first life to the start of
+    // the ones before LAST_LIFE
+    GLfloat series[START_BOUNCES + 1];
+    GLfloat lifeStarts[LAST_LIFE + 1];
+
+    static GLint maxBounces( GLuint life )
+    {
+        GLint bounces = START_BOUNCES - BOUNCE_LOSS * ( GLint )life;
+        return ( bounces > 0 ) ? bounces : 0;
+    }
+
+    // Height a cube at depth 'z' lands at, on the tread under it. In front of the flight that is the floor, the bottom
+    // tread, and past its far end the top one.
+    GLfloat floorHeight( GLfloat z ) const
+    {
+        GLfloat step = std::floor( ( this->origin.z - z ) / this->run );
+        step = std::min( std::max( step, 0.0f ), ( GLfloat )this->steps );
+        return this->origin.y + step * this->rise + FLOOR_REST;
+    }
+
+    // Time from the start of the first life to the start of 'life'
+    GLfloat lifeOffset( GLuint life ) const
+    {
+        return ( life < LAST_LIFE ) ? this->lifeStarts[life] : this->lifeStarts[LAST_LIFE] + ( life - LAST_LIFE ) * DROP_TIME;
+    }
+
+    // The life that is on 'lifeTime' after the start of the first, lives without bounces all last DROP_TIME
+    GLuint lifeAt( GLfloat lifeTime ) const
+    {
+        if ( lifeTime < this->lifeStarts[LAST_LIFE] )
+        {
+            return ( GLuint )( std::upper_bound( this->lifeStarts + 1, this->lifeStarts + LAST_LIFE, lifeTime ) - this->lifeStarts ) - 1;
+        }
+
+        // Off by one either way where rounding puts it
+        GLuint life = LAST_LIFE + ( GLuint )( ( lifeTime - this->lifeStarts[LAST_LIFE] ) / DROP_TIME );
+        if ( life > LAST_LIFE && lifeTime < this->lifeOffset( life ) )
+        {
+            life--;
+        }
+        else if ( lifeTime >= this->lifeOffset( life + 1 ) )
+        {
+            life++;
+        }
+        return life;
+    }
+
+    // Life 'number' of cube 'i'
+    Life lifeOf( GLuint i, GLuint number ) const
+    {
+        const Life &first = this->firstLives[i];
+        return ( 0 == number ) ? first : this->lifeOf( this->seeds[i], number, first.start + this->lifeOffset( number ) );
+    }
+
+    // Life 'number' of the cube of 'seed' starting at 'start', somewhere over the top RESTART_DEPTH of the flight
+    Life lifeOf( GLuint seed, GLuint number, GLfloat start ) const
+    {
+        GLfloat far = this->origin.z - ( this->steps + 1 ) * this->run;
+        GLfloat depth = std::min( RESTART_DEPTH, ( this->steps + 1 ) * this->run );
+        GLfloat across = this->width - 2.0f * RESTART_INSET;
+        Life life = { number, start, glm::vec3( 0.0f, this->origin.y + this->steps * this->rise + RESTART_HEIGHT, 0.0f ) };
+        life.position.x = this->origin.x + across * ( hash( seed, number, 0 ) - 0.5f );
+        life.position.z = far + depth * hash( seed, number, 1 );
+        return life;
+    }
+
+    // Time from the start of a life to the start of bounce 'bounce'
+    GLfloat bounceStart( GLint bounce ) const
+    {
+        return DROP_TIME + this->series[bounce];
+    }
+
+    // Height of the step under the cube 'time' after the start of 'life'
+    GLfloat floorAt( const Life &life, GLfloat time ) const
+    {
+        return this->floorHeight( life.position.z + DRIFT * time );
+    }
+
+    // Where the drop starts, over the steps under the cube at its start and where it lands
+    GLfloat dropHeight( const Life &life ) const
+    {
+        GLfloat least = std::max( this->floorAt( life, 0.0f ), this->floorAt( life, DROP_TIME ) ) + MIN_DROP;
+        return ( life.position.y > least ) ? life.position.y : least;
+    }
+
+    // A number in [0, 1) from a seed, a life and which number of the life it is (the finalizer of MurmurHash3)
+    static GLfloat hash( GLuint seed, GLuint life, GLuint which )
+    {
+        uint32_t h = seed * 0x9E3779B9u + life * 0x85EBCA6Bu + which * 0xC2B2AE35u;
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        return ( h >> 8 ) * ( 1.0f / 16777216.0f );
+    }
+
+    // The parabola of 'life' that starts 'start' after it from 'from' high and lands 'duration' later 'to' high
+    static Arc arcOf( const Life &life, GLint bounce, GLfloat start, GLfloat duration, GLfloat from, GLfloat to )
+    {
+        Arc arc = { bounce, life.start + start, life.start + start + duration, from, ( to - from ) / duration + 0.5f * GRAVITY * duration };
+        return arc;
+    }
+
+    static glm::vec3 evaluate( const Life &life, const Arc &arc, GLfloat time )
+    {
+        GLfloat arcTime = time - arc.start;
+        GLfloat y = arc.height + ( arc.velocity - 0.5f * GRAVITY * arcTime ) * arcTime;
+        return glm::vec3( life.position.x, y, life.position.z + DRIFT * ( time - life.start ) );
+    }
+
+    // The life and parabola cube 'i' is on at 'time', in constant time. 'hint' is the bounce the cube was on last, when the
+    // caller knows it: mostly the cube is on the one after it, which is checked before the series is inverted.
+    void locate( GLuint i, GLfloat time, GLint hint, Life &life, Arc &arc ) const
+    {
+        life = this->lifeOf( i, this->lifeAt( time - this->firstLives[i].start ) );
+        // A cube without bounces left starts over when it lands
+        GLfloat lifeTime = time - life.start;
+        GLint last = maxBounces( life.number ) - 1;
+        if ( lifeTime < DROP_TIME || last < 0 )
+        {
+            arc = arcOf( life, DROP, 0.0f, DROP_TIME, this->dropHeight( life ), this->floorAt( life, DROP_TIME ) );
+            this->endLife( i, life, arc );
+            return;
+        }
+
+        GLint bounce = hint + 1;
+        bool next = bounce >= 0 && bounce <= last && lifeTime >= bounceStart( bounce )
+                    && ( bounce == last || lifeTime < bounceStart( bounce + 1 ) );
+        if ( !next )
+        {
+            GLfloat remaining = 1.0f - ( lifeTime - DROP_TIME ) * ( 1.0f - RESTITUTION ) / FIRST_BOUNCE;
+            bounce = ( remaining > 0.0f ) ? ( GLint )( std::log( remaining ) / std::log( RESTITUTION ) ) : last;
+            bounce = ( bounce < last ) ? bounce : last;
+            bounce = ( bounce > 0 ) ? bounce : 0;
+        }
+        // The estimate can be off by one either way where rounding puts it
+        if ( bounce > 0 && lifeTime < bounceStart( bounce ) )
+        {
+            bounce--;
+        }
+        else if ( bounce < last && lifeTime >= bounceStart( bounce + 1 ) )
+        {
+            bounce++;
+        }
+
+        // Leaves the step it landed on and lands on the step under it when it ends
+        GLfloat start = bounceStart( bounce ), end = bounceStart( bounce + 1 );
+        arc = arcOf( life, bounce, start, end - start, this->floorAt( life, start ), this->floorAt( life, end ) );
+        this->endLife( i, life, arc );
+    }
+
+    // The last parabola of a life ends where the next life starts, rounded the same
+    void endLife( GLuint i, const Life &life, Arc &arc ) const
+    {
+        if ( arc.bounce == maxBounces( life.number ) - 1 )
+        {
+            arc.end = this->firstLives[i].start + this->lifeOffset( life.number + 1 );
+        }
+    }
+
+    void cacheArc( GLuint i, GLfloat time )
+    {
+        Life life;
+        Arc arc;
+        this->locate( i, time, this->cachedBounces[i], life, arc );
+        this->cachedBounces[i] = arc.bounce;
+        this->x[i] = life.position.x;
+        this->startTime[i] = life.start;
+        this->startZ[i] = life.position.z;
+        this->arcStart[i] = arc.start;
+        this->arcEnd[i] = arc.end;
+        this->arcHeight[i] = arc.height;
+        this->arcVelocity[i] = arc.velocity;
+        this->arcChanges.fetch_add( 1, std::memory_order_relaxed );
+    }
+};
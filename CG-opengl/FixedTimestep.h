@@ -0,0 +1,54 @@
+#pragma once
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Runs a simulation in steps of fixed length whatever the frame rate. The time of every frame goes into an accumulator
+// and is paid out in whole steps; what is left over is how far the frame lies between the last two simulated states, which
+// the renderer interpolates with. After a stall at most 'maxSteps' steps are run in one frame and the rest of the time is
+// dropped, so a slow frame can't lead into ever longer catch-ups.
+class FixedTimestep
+{
+public:
+    FixedTimestep( GLfloat step, GLuint maxSteps ) : step( step ), maxSteps( maxSteps ), accumulator( 0.0f ), droppedSteps( 0 )
+    {
+    }
+
+    // Adds the time of a frame and returns the number of steps to simulate in it
+    GLuint Advance( GLfloat frameTime )
+    {
+        this->accumulator += ( frameTime > 0.0f ) ? frameTime : 0.0f;
+        GLuint steps = ( GLuint )( this->accumulator / this->step );
+        if ( steps > this->maxSteps )
+        {
+            this->droppedSteps += steps - this->maxSteps;
+            steps = this->maxSteps;
+            this->accumulator = 0.0f;
+        }
+        else
+        {
+            this->accumulator -= steps * this->step;
+        }
+        return steps;
+    }
+
+    // Where the frame lies between the state before the last step (0) and after it (1)
+    GLfloat GetAlpha( ) const
+    {
+        GLfloat alpha = this->accumulator / this->step;
+        return ( alpha < 1.0f ) ? alpha : 1.0f;
+    }
+
+    // Steps dropped to the catch-up limit since the start
+    GLuint GetDroppedSteps( ) const
+    {
+        return this->droppedSteps;
+    }
+
+private:
+    GLfloat step;
+    GLuint maxSteps;
+    GLfloat accumulator;
+    GLuint droppedSteps;
+};
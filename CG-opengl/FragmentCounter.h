@@ -0,0 +1,115 @@
+#pragma once
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "Shader.h"
+#include "GLState.h"
+
+// Counts how many fragments the lit pass shades and how many pixels end up covered by geometry, their ratio is the overdraw.
+// With ARB_pipeline_statistics_query the fragment shader invocations are counted directly, otherwise the samples that
+// passed the depth test, which is the same thing as long as the depth test runs before the fragment shader.
+// Queries are double buffered and read one frame late so the counts never stall the pipeline.
+class FragmentCounter
+{
+public:
+    FragmentCounter( ) : frame( 0 ), shaded( 0 ), covered( 0 )
+    {
+        this->countsInvocations = GLEW_ARB_pipeline_statistics_query;
+        this->target = this->countsInvocations ? GL_FRAGMENT_SHADER_INVOCATIONS_ARB : GL_SAMPLES_PASSED;
+        glGenQueries( 2, this->shadedQueries );
+        glGenQueries( 2, this->coveredQueries );
+        this->pending[0] = this->pending[1] = false;
+    }
+
+    // Frees the queries, has to be called while the context is still alive
+    void Delete( )
+    {
+        glDeleteQueries( 2, this->shadedQueries );
+        glDeleteQueries( 2, this->coveredQueries );
+    }
+
+    // Wrap the lit pass in these two
+    void BeginShading( )
+    {
+        glBeginQuery( this->target, this->shadedQueries[this->frame] );
+    }
+
+    void EndShading( )
+    {
+        glEndQuery( this->target );
+    }
+
+    // Counts the pixels that hold geometry, by drawing a far plane triangle that only passes where something closer was drawn
+    void MeasureCoverage( Shader &coverageShader, GLuint emptyVAO )
+    {
+        glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+        glDepthMask( GL_FALSE );
+        glDepthFunc( GL_GREATER );
+
+        coverageShader.Use( );
+        GLState::Get( ).BindVertexArray( emptyVAO );
+        glBeginQuery( GL_SAMPLES_PASSED, this->coveredQueries[this->frame] );
+        glDrawArrays( GL_TRIANGLES, 0, 3 );
+        glEndQuery( GL_SAMPLES_PASSED );
+
+        glDepthFunc( GL_LESS );
+        glDepthMask( GL_TRUE );
+        glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+        this->pending[this->frame] = true;
+    }
+
+    // Picks up the counts of the previous frame if the GPU is done with them and switches query sets
+    void EndFrame( )
+    {
+        this->frame = 1 - this->frame;
+        if ( !this->pending[this->frame] )
+        {
+            return;
+        }
+
+        GLuint available;
+        glGetQueryObjectuiv( this->coveredQueries[this->frame], GL_QUERY_RESULT_AVAILABLE, &available );
+        if ( available )
+        {
+            glGetQueryObjectuiv( this->shadedQueries[this->frame], GL_QUERY_RESULT, &this->shaded );
+            glGetQueryObjectuiv( this->coveredQueries[this->frame], GL_QUERY_RESULT, &this->covered );
+        }
+        this->pending[this->frame] = false;
+    }
+
+    // Fragments shaded by the lit pass in the last counted frame
+    GLuint GetShadedFragments( ) const
+    {
+        return this->shaded;
+    }
+
+    // Pixels covered by geometry in the last counted frame
+    GLuint GetCoveredPixels( ) const
+    {
+        return this->covered;
+    }
+
+    // Shaded fragments per covered pixel, 1.0 means no fragment was shaded twice
+    GLfloat GetOverdraw( ) const
+    {
+        return ( 0 == this->covered ) ? 0.0f : ( GLfloat )this->shaded / this->covered;
+    }
+
+    // True when GetShadedFragments counts fragment shader invocations rather than samples passed
+    bool CountsInvocations( ) const
+    {
+        return this->countsInvocations;
+    }
+
+private:
+    bool countsInvocations;
+    GLenum target;
+    GLuint shadedQueries[2];
+    GLuint coveredQueries[2];
+    bool pending[2];
+    GLuint frame;
+    GLuint shaded;
+    GLuint covered;
+};
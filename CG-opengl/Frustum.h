@@ -0,0 +1,225 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+
+#if defined( __SSE2__ )
+#include <immintrin.h>
+#endif
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// The six planes of a view frustum as (normal, distance) with the normals pointing inwards.
+// A point p is inside a plane when dot( normal, p ) + distance >= 0.
+class Frustum
+{
+public:
+    glm::vec4 Planes[6];
+
+    // Extracts the planes from the rows of a view-projection matrix (Gribb & Hartmann)
+    Frustum( const glm::mat4 &viewProjection )
+    {
+        glm::vec4 rows[4];
+        for ( GLuint row = 0; row < 4; row++ )
+        {
+            rows[row] = glm::vec4( viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row] );
+        }
+
+        // Left, right, bottom, top, near, far
+        for ( GLuint axis = 0; axis < 3; axis++ )
+        {
+            this->Planes[axis * 2] = rows[3] + rows[axis];
+            this->Planes[axis * 2 + 1] = rows[3] - rows[axis];
+        }
+    }
+
+    // The six faces of the box from 'min' to 'max', for testing boxes against a region that isn't a view
+    Frustum( glm::vec3 min, glm::vec3 max )
+    {
+        for ( GLuint axis = 0; axis < 3; axis++ )
+        {
+            glm::vec4 normal( 0.0f );
+            normal[axis] = 1.0f;
+            this->Planes[axis * 2] = glm::vec4( glm::vec3( normal ), -min[axis] );
+            this->Planes[axis * 2 + 1] = glm::vec4( -glm::vec3( normal ), max[axis] );
+        }
+    }
+};
+
+// Axis aligned boxes kept as separate min/max arrays per axis so the culling test runs on several boxes per instruction. Per
+// plane only the box corner furthest along the plane normal is tested; when even that one is behind the plane the whole box
+// is outside. On x86 the boxes are tested in blocks of 8: with AVX when the CPU has it, which is asked once at runtime unless
+// the build targets AVX anyway, otherwise as two halves with SSE2. Other targets test one box at a time.
+class BoxCuller
+{
+public:
+    BoxCuller( ) : count( 0 )
+    {
+    }
+
+    // Sets the number of boxes, the ones added are empty until set
+    void Resize( GLuint count )
+    {
+        this->count = count;
+        size_t padded = ( count + LANES - 1 ) / LANES * LANES;
+        std::vector<GLfloat> *arrays[6] = { &this->minX, &this->minY, &this->minZ, &this->maxX, &this->maxY, &this->maxZ };
+        for ( GLuint i = 0; i < 6; i++ )
+        {
+            arrays[i]->resize( padded, 0.0f );
+        }
+    }
+
+    void SetBox( GLuint i, glm::vec3 min, glm::vec3 max )
+    {
+        this->minX[i] = min.x;
+        this->minY[i] = min.y;
+        this->minZ[i] = min.z;
+        this->maxX[i] = max.x;
+        this->maxY[i] = max.y;
+        this->maxZ[i] = max.z;
+    }
+
+    GLuint GetCount( ) const
+    {
+        return this->count;
+    }
+
+    // Replaces 'visible' with the indices of the boxes that are at least partly inside the frustum, in increasing order
+    void Cull( const Frustum &frustum, std::vector<GLuint> &visible ) const
+    {
+        std::vector<GLuint> inside( ( this->count + LANES - 1 ) / LANES );
+        this->Test( frustum, 0, this->count, inside.data( ) );
+        this->Collect( inside.data( ), visible );
+    }
+
+    // Boxes of a block, tested together
+#if defined( __SSE2__ )
+    static const GLuint LANES = 8;
+#else
+    static const GLuint LANES = 1;
+#endif
+
+    // Cull in two halves, so the test can be split over threads. Test sets a bit per box of the boxes [first, last) in
+    // inside[box / LANES], 'first' a multiple of LANES, and Collect turns the bits of every box into the list Cull returns.
+    void Test( const Frustum &frustum, size_t first, size_t last, GLuint *inside ) const
+    {
+#if defined( __SSE2__ ) && !defined( __AVX__ )
+        if ( !hasAVX( ) )
+        {
+            for ( size_t i = first; i < last; i += LANES )
+            {
+                inside[i / LANES] = this->testBlockSSE( frustum, i );
+            }
+            return;
+        }
+#endif
+        for ( size_t i = first; i < last; i += LANES )
+        {
+            inside[i / LANES] = this->testBlock( frustum, i );
+        }
+    }
+
+    void Collect( const GLuint *inside, std::vector<GLuint> &visible ) const
+    {
+        visible.clear( );
+        for ( size_t i = 0; i < this->count; i += LANES )
+        {
+            for ( GLuint lane = 0; 0 != inside[i / LANES] && lane < LANES && i + lane < this->count; lane++ )
+            {
+                if ( inside[i / LANES] & ( 1u << lane ) )
+                {
+                    visible.push_back( ( GLuint )( i + lane ) );
+                }
+            }
+        }
+    }
+
+private:
+    static const GLuint ALL_LANES = ( 1u << LANES ) - 1;
+
+    GLuint count;
+    std::vector<GLfloat> minX, minY, minZ;
+    std::vector<GLfloat> maxX, maxY, maxZ;
+
+    // The corner of the boxes from 'first' on furthest along the normal of 'plane', picked per axis by the sign of the normal
+    void corner( const glm::vec4 &plane, size_t first, const GLfloat *&x, const GLfloat *&y, const GLfloat *&z ) const
+    {
+        x = ( plane.x > 0.0f ) ? &this->maxX[first] : &this->minX[first];
+        y = ( plane.y > 0.0f ) ? &this->maxY[first] : &this->minY[first];
+        z = ( plane.z > 0.0f ) ? &this->maxZ[first] : &this->minZ[first];
+    }
+
+#if defined( __SSE2__ )
+    // Returns a bit per box of the block starting at 'first', set when the box is not outside any plane. Built for AVX
+    // whatever the build targets, so it may only run where hasAVX says so.
+#if !defined( __AVX__ )
+    __attribute__( ( target( "avx" ) ) )
+#endif
+    GLuint testBlock( const Frustum &frustum, size_t first ) const
+    {
+        GLuint outside = 0;
+        for ( GLuint p = 0; p < 6 && ALL_LANES != outside; p++ )
+        {
+            const glm::vec4 &plane = frustum.Planes[p];
+            const GLfloat *x, *y, *z;
+            this->corner( plane, first, x, y, z );
+            __m256 distance = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( plane.x ), _mm256_loadu_ps( x ) ),
+                                                            _mm256_mul_ps( _mm256_set1_ps( plane.y ), _mm256_loadu_ps( y ) ) ),
+                                             _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( plane.z ), _mm256_loadu_ps( z ) ),
+                                                            _mm256_set1_ps( plane.w ) ) );
+            outside |= ( GLuint )_mm256_movemask_ps( _mm256_cmp_ps( distance, _mm256_setzero_ps( ), _CMP_LT_OQ ) );
+        }
+        return ~outside & ALL_LANES;
+    }
+
+#if !defined( __AVX__ )
+    // testBlock for CPUs without AVX, the block as two halves of 4 boxes
+    GLuint testBlockSSE( const Frustum &frustum, size_t first ) const
+    {
+        GLuint outside = 0;
+        for ( GLuint p = 0; p < 6 && ALL_LANES != outside; p++ )
+        {
+            const glm::vec4 &plane = frustum.Planes[p];
+            const GLfloat *x, *y, *z;
+            this->corner( plane, first, x, y, z );
+            for ( GLuint half = 0; half < LANES; half += 4 )
+            {
+                __m128 distance = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( plane.x ), _mm_loadu_ps( x + half ) ),
+                                                          _mm_mul_ps( _mm_set1_ps( plane.y ), _mm_loadu_ps( y + half ) ) ),
+                                              _mm_add_ps( _mm_mul_ps( _mm_set1_ps( plane.z ), _mm_loadu_ps( z + half ) ),
+                                                          _mm_set1_ps( plane.w ) ) );
+                outside |= ( GLuint )_mm_movemask_ps( _mm_cmplt_ps( distance, _mm_setzero_ps( ) ) ) << half;
+            }
+        }
+        return ~outside & ALL_LANES;
+    }
+
+    // Whether the CPU and the OS run AVX, asked on the first call only
+    static bool hasAVX( )
+    {
+        static const bool avx = __builtin_cpu_supports( "avx" );
+        return avx;
+    }
+#endif
+#else
+    // Returns a bit for the box at 'first', set when the box is not outside any plane
+    GLuint testBlock( const Frustum &frustum, size_t first ) const
+    {
+        for ( GLuint p = 0; p < 6; p++ )
+        {
+            const glm::vec4 &plane = frustum.Planes[p];
+            const GLfloat *x, *y, *z;
+            this->corner( plane, first, x, y, z );
+            if ( plane.x * *x + plane.y * *y + plane.z * *z + plane.w < 0.0f )
+            {
+                return 0;
+            }
+        }
+        return ALL_LANES;
+    }
+#endif
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+// Std. Includes
+#include <iostream>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "GLState.h"
+
+// Texture units the G-buffer is read from during the lighting passes
+const GLuint GBUFFER_POSITION_UNIT = 0;
+const GLuint GBUFFER_NORMAL_UNIT = 1;
+const GLuint GBUFFER_ALBEDO_SPEC_UNIT = 2;
+
+// Framebuffer for deferred shading. The geometry pass writes world space position, normal and albedo + specular intensity
+// once per pixel, afterwards every light only reads back the pixels it touches.
+class GBuffer
+{
+public:
+    GBuffer( GLint width, GLint height ) : width( width ), height( height )
+    {
+        glGenFramebuffers( 1, &this->FBO );
+        glBindFramebuffer( GL_FRAMEBUFFER, this->FBO );
+
+        // Position and normal need more than 8 bits, albedo and specular fit in one RGBA8 texture
+        this->position = this->attach( GL_COLOR_ATTACHMENT0, GL_RGB16F, GL_RGB, GL_FLOAT );
+        this->normal = this->attach( GL_COLOR_ATTACHMENT1, GL_RGB16F, GL_RGB, GL_FLOAT );
+        this->albedoSpec = this->attach( GL_COLOR_ATTACHMENT2, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE );
+
+        GLenum attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+        glDrawBuffers( 3, attachments );
+
+        // Same depth format as the default framebuffer so the depth can be blitted back for the forward drawn lamps
+        glGenRenderbuffers( 1, &this->depth );
+        glBindRenderbuffer( GL_RENDERBUFFER, this->depth );
+        glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height );
+        glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depth );
+
+        if ( GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus( GL_FRAMEBUFFER ) )
+        {
+            std::cout << "ERROR::GBUFFER::FRAMEBUFFER_NOT_COMPLETE" << std::endl;
+        }
+
+        glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+    }
+
+    // Frees the framebuffer and its attachments, has to be called while the context is still alive
+    void Delete( )
+    {
+        GLuint textures[3] = { this->position, this->normal, this->albedoSpec };
+        glDeleteTextures( 3, textures );
+        glDeleteRenderbuffers( 1, &this->depth );
+        glDeleteFramebuffers( 1, &this->FBO );
+    }
+
+    // Makes the G-buffer the render target of the geometry pass
+    void BindForWriting( )
+    {
+        glBindFramebuffer( GL_FRAMEBUFFER, this->FBO );
+    }
+
+    // Binds the three attachments to the GBUFFER_* texture units for the lighting passes
+    void BindForReading( )
+    {
+        GLState::Get( ).BindTexture( GBUFFER_POSITION_UNIT, GL_TEXTURE_2D, this->position );
+        GLState::Get( ).BindTexture( GBUFFER_NORMAL_UNIT, GL_TEXTURE_2D, this->normal );
+        GLState::Get( ).BindTexture( GBUFFER_ALBEDO_SPEC_UNIT, GL_TEXTURE_2D, this->albedoSpec );
+    }
+
+    // Copies the depth of the geometry pass into the default framebuffer so forward passes can be depth tested against it
+    void BlitDepth( )
+    {
+        glBindFramebuffer( GL_READ_FRAMEBUFFER, this->FBO );
+        glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+        glBlitFramebuffer( 0, 0, this->width, this->height, 0, 0, this->width, this->height, GL_DEPTH_BUFFER_BIT, GL_NEAREST );
+        glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+    }
+
+private:
+    GLuint FBO;
+    GLuint position, normal, albedoSpec;
+    GLuint depth;
+    GLint width, height;
+
+    GLuint attach( GLenum attachment, GLint internalFormat, GLenum format, GLenum type )
+    {
+        GLuint texture;
+        glGenTextures( 1, &texture );
+        GLState::Get( ).BindTexture( 0, GL_TEXTURE_2D, texture );
+        glTexImage2D( GL_TEXTURE_2D, 0, internalFormat, this->width, this->height, 0, format, type, NULL );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+        glFramebufferTexture2D( GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0 );
+        GLState::Get( ).BindTexture( 0, GL_TEXTURE_2D, 0 );
+        return texture;
+    }
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+// Std. Includes
+#include <cstring>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Number of texture units whose bindings are tracked, units above it are always bound
+const GLuint GL_STATE_TEXTURE_UNITS = 16;
+
+// Thin layer over the binding calls of the program, the VAO, the buffers and the texture units. It remembers what is bound and
+// drops calls that would not change anything. Every bind in the application has to go through it, otherwise its view of the
+// context goes stale. Calls issued and dropped are counted per frame.
+class GLState
+{
+public:
+    // Kinds of calls that are counted
+    enum Call
+    {
+        PROGRAM,
+        VERTEX_ARRAY,
+        BUFFER,
+        TEXTURE,
+        UNIFORM,
+        CALL_KINDS
+    };
+
+    // The one context of the application
+    static GLState &Get( )
+    {
+        static GLState state;
+        return state;
+    }
+
+    void UseProgram( GLuint program )
+    {
+        if ( this->record( PROGRAM, program == this->program ) )
+        {
+            this->program = program;
+            glUseProgram( program );
+        }
+    }
+
+    void BindVertexArray( GLuint VAO )
+    {
+        if ( this->record( VERTEX_ARRAY, VAO == this->vertexArray ) )
+        {
+            this->vertexArray = VAO;
+            glBindVertexArray( VAO );
+        }
+    }
+
+    // The element array binding belongs to the bound VAO, so it and other untracked targets are always passed on
+    void BindBuffer( GLenum target, GLuint buffer )
+    {
+        GLuint *bound = this->bufferSlot( target );
+        if ( !this->record( BUFFER, NULL != bound && buffer == *bound ) )
+        {
+            return;
+        }
+
+        if ( NULL != bound )
+        {
+            *bound = buffer;
+        }
+        glBindBuffer( target, buffer );
+    }
+
+    // Indexed binds are always issued, but they also replace the generic binding of the target
+    void BindBufferBase( GLenum target, GLuint index, GLuint buffer )
+    {
+        GLuint *bound = this->bufferSlot( target );
+        this->record( BUFFER, false );
+        if ( NULL != bound )
+        {
+            *bound = buffer;
+        }
+        glBindBufferBase( target, index, buffer );
+    }
+
+    // Binds a texture to a unit, the active texture unit is only switched when the binding actually changes
+    void BindTexture( GLuint unit, GLenum target, GLuint texture )
+    {
+        GLuint *bound = this->textureSlot( unit, target );
+        if ( !this->record( TEXTURE, NULL != bound && texture == *bound ) )
+        {
+            return;
+        }
+
+        if ( NULL != bound )
+        {
+            *bound = texture;
+        }
+        if ( unit != this->activeTexture )
+        {
+            this->activeTexture = unit;
+            glActiveTexture( GL_TEXTURE0 + unit );
+        }
+        glBindTexture( target, texture );
+    }
+
+    // Uniform values are cached by the Shader that owns them, this only keeps the count
+    void RecordUniform( bool redundant )
+    {
+        this->record( UNIFORM, redundant );
+    }
+
+    // Closes the counters of the frame, GetIssued/GetDropped then report it until the next call
+    void EndFrame( )
+    {
+        std::memcpy( this->lastIssued, this->issued, sizeof( this->issued ) );
+        std::memcpy( this->lastDropped, this->dropped, sizeof( this->dropped ) );
+        std::memset( this->issued, 0, sizeof( this->issued ) );
+        std::memset( this->dropped, 0, sizeof( this->dropped ) );
+    }
+
+    // Calls of one kind that reached GL in the last frame
+    GLuint GetIssued( Call kind ) const
+    {
+        return this->lastIssued[kind];
+    }
+
+    // Calls of one kind that were dropped in the last frame
+    GLuint GetDropped( Call kind ) const
+    {
+        return this->lastDropped[kind];
+    }
+
+private:
+    GLuint program;
+    GLuint vertexArray;
+    GLuint arrayBuffer, uniformBuffer, textureBuffer;
+    GLuint activeTexture;
+    GLuint textures2D[GL_STATE_TEXTURE_UNITS];
+    GLuint textureBuffers[GL_STATE_TEXTURE_UNITS];
+    GLuint issued[CALL_KINDS], dropped[CALL_KINDS];
+    GLuint lastIssued[CALL_KINDS], lastDropped[CALL_KINDS];
+
+    // Starts from the state of a new context, where everything is bound to 0
+    GLState( ) : program( 0 ), vertexArray( 0 ), arrayBuffer( 0 ), uniformBuffer( 0 ), textureBuffer( 0 ), activeTexture( 0 )
+    {
+        std::memset( this->textures2D, 0, sizeof( this->textures2D ) );
+        std::memset( this->textureBuffers, 0, sizeof( this->textureBuffers ) );
+        std::memset( this->issued, 0, sizeof( this->issued ) );
+        std::memset( this->dropped, 0, sizeof( this->dropped ) );
+        this->EndFrame( );
+    }
+
+    GLState( const GLState & );
+    GLState &operator=( const GLState & );
+
+    // Counts a call and returns true when it has to be issued
+    bool record( Call kind, bool redundant )
+    {
+        if ( redundant )
+        {
+            this->dropped[kind]++;
+            return false;
+        }
+
+        this->issued[kind]++;
+        return true;
+    }
+
+    GLuint *bufferSlot( GLenum target )
+    {
+        switch ( target )
+        {
+            case GL_ARRAY_BUFFER:
+                return &this->arrayBuffer;
+            case GL_UNIFORM_BUFFER:
+                return &this->uniformBuffer;
+            case GL_TEXTURE_BUFFER:
+                return &this->textureBuffer;
+            default:
+                return NULL;
+        }
+    }
+
+    GLuint *textureSlot( GLuint unit, GLenum target )
+    {
+        if ( unit >= GL_STATE_TEXTURE_UNITS )
+        {
+            return NULL;
+        }
+
+        switch ( target )
+        {
+            case GL_TEXTURE_2D:
+                return &this->textures2D[unit];
+            case GL_TEXTURE_BUFFER:
+                return &this->textureBuffers[unit];
+            default:
+                return NULL;
+        }
+    }
+};
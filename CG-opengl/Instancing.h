@@ -0,0 +1,136 @@
+#pragma once
+
+// Std. Includes
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Transforms.h"
+#include "GLState.h"
+
+// Attribute locations of the first column of each per instance matrix (lighting.vs and lamp.vs)
+const GLuint INSTANCE_MODEL_LOCATION = 3;
+const GLuint INSTANCE_NORMAL_LOCATION = 7;
+const GLuint INSTANCE_MVP_LOCATION = 10;
+
+// Vertex buffer of per instance transforms (model, normal and model-view-projection matrix). Attached to a VAO as an instanced attribute it lets one
+// glDrawArraysInstanced call draw every object that shares the mesh, however many there are.
+class InstanceBuffer
+{
+public:
+    InstanceBuffer( ) : count( 0 ), capacity( 0 )
+    {
+        glGenBuffers( 1, &this->VBO );
+    }
+
+    // Frees the buffer, has to be called while the context is still alive
+    void Delete( )
+    {
+        glDeleteBuffers( 1, &this->VBO );
+    }
+
+    // Adds the matrix attributes to a VAO, advancing once per instance instead of once per vertex
+    void AttachTo( GLuint VAO )
+    {
+        GLState::Get( ).BindVertexArray( VAO );
+        GLState::Get( ).BindBuffer( GL_ARRAY_BUFFER, this->VBO );
+        this->pointColumns( 0 );
+        for ( GLuint location = INSTANCE_MODEL_LOCATION; location < INSTANCE_MVP_LOCATION + 4; location++ )
+        {
+            glEnableVertexAttribArray( location );
+            glVertexAttribDivisor( location, 1 );
+        }
+        this->firstInstances[VAO] = 0;
+        GLState::Get( ).BindVertexArray( 0 );
+    }
+
+    // Makes the draws of a VAO this buffer is attached to start at instance 'first'. GL 3.3 has no base instance for
+    // glDrawArraysInstanced, so the attributes are pointed further into the buffer instead; that takes 11 calls, which are
+    // skipped while the VAO already starts there. Leaves the VAO bound.
+    void SetFirstInstance( GLuint VAO, GLuint first )
+    {
+        GLState::Get( ).BindVertexArray( VAO );
+        GLuint &current = this->firstInstances[VAO];
+        if ( first != current )
+        {
+            current = first;
+            GLState::Get( ).BindBuffer( GL_ARRAY_BUFFER, this->VBO );
+            this->pointColumns( first );
+        }
+    }
+
+    // Replaces the instances with the last Update of a transform system. The storage only grows, and is orphaned
+    // before every upload so we never wait on the GPU still reading last frame's data
+    void Upload( const TransformSystem &transforms )
+    {
+        this->count = transforms.GetCount( );
+
+        GLState::Get( ).BindBuffer( GL_ARRAY_BUFFER, this->VBO );
+        if ( this->count > this->capacity )
+        {
+            this->capacity = this->count;
+        }
+        glBufferData( GL_ARRAY_BUFFER, this->capacity * sizeof( InstanceTransform ), NULL, GL_STREAM_DRAW );
+        if ( this->count > 0 )
+        {
+            glBufferSubData( GL_ARRAY_BUFFER, 0, this->count * sizeof( InstanceTransform ), transforms.GetInstances( ) );
+        }
+    }
+
+    // Same as above but only uploads the listed instances, e.g. the ones that survived culling
+    void Upload( const TransformSystem &transforms, const std::vector<GLuint> &visible )
+    {
+        this->staging.resize( visible.size( ) );
+        for ( size_t i = 0; i < visible.size( ); i++ )
+        {
+            this->staging[i] = transforms.GetInstances( )[visible[i]];
+        }
+
+        this->count = ( GLuint )visible.size( );
+        GLState::Get( ).BindBuffer( GL_ARRAY_BUFFER, this->VBO );
+        if ( this->count > this->capacity )
+        {
+            this->capacity = this->count;
+        }
+        glBufferData( GL_ARRAY_BUFFER, this->capacity * sizeof( InstanceTransform ), NULL, GL_STREAM_DRAW );
+        if ( this->count > 0 )
+        {
+            glBufferSubData( GL_ARRAY_BUFFER, 0, this->count * sizeof( InstanceTransform ), this->staging.data( ) );
+        }
+    }
+
+    // Number of instances in the last upload
+    GLuint GetCount( ) const
+    {
+        return this->count;
+    }
+
+private:
+    GLuint VBO;
+    GLuint count;
+    GLuint capacity;
+    std::vector<InstanceTransform> staging;
+    // Instance each attached VAO currently starts at
+    std::unordered_map<GLuint, GLuint> firstInstances;
+
+    // Every matrix column is a vec4 slot, the normal matrix only reads 3 components of its slots
+    void pointColumns( GLuint first )
+    {
+        size_t base = first * sizeof( InstanceTransform );
+        for ( GLuint column = 0; column < 4; column++ )
+        {
+            glVertexAttribPointer( INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof( InstanceTransform ), ( GLvoid * )( base + offsetof( InstanceTransform, model ) + column * sizeof( glm::vec4 ) ) );
+            glVertexAttribPointer( INSTANCE_MVP_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof( InstanceTransform ), ( GLvoid * )( base + offsetof( InstanceTransform, mvp ) + column * sizeof( glm::vec4 ) ) );
+        }
+        for ( GLuint column = 0; column < 3; column++ )
+        {
+            glVertexAttribPointer( INSTANCE_NORMAL_LOCATION + column, 3, GL_FLOAT, GL_FALSE, sizeof( InstanceTransform ), ( GLvoid * )( base + offsetof( InstanceTransform, normal ) + column * sizeof( glm::vec4 ) ) );
+        }
+    }
+};
@@ -0,0 +1,419 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Jobs a fork/join waits for. Every job added with the counter raises it, every one that finishes lowers it.
+struct JobCounter
+{
+    std::atomic<GLint> pending;
+
+    JobCounter( ) : pending( 0 )
+    {
+    }
+};
+
+// A job is a function run on a range of items, with the counter it reports to
+struct Job
+{
+    void ( *function )( const Job &job );
+    const void *data;
+    size_t begin;
+    size_t end;
+    size_t chunk;
+    JobCounter *counter;
+};
+
+// Chase-Lev work stealing deque (in the C11 formulation of Lê, Pop, Cohen and Zappa Nardelli) of a fixed capacity. The worker
+// owning it pushes and pops at the bottom without locks or, unless one job is left, atomic read-modify-writes; other workers
+// steal from the top with a compare-and-swap. Jobs are stolen oldest first, and the oldest jobs of a parallel for are its
+// largest ranges, so a steal takes away a lot of work at once.
+//
+// The jobs are kept in CAPACITY slots, the job at position p in slot p % CAPACITY, with every field an atomic so a slot can
+// be read while it is written. A thief copies the job at the top out before its compare-and-swap, and the swap succeeding
+// proves the copy whole: Push only writes position p after reading a top above p - CAPACITY, so the slot of the top t is
+// only written again for t + CAPACITY once the top has moved past t, and then the swap from t fails. That read of the top is
+// an acquire of the swap that moved it, so a copy made before the swap never sees the later write.
+class JobDeque
+{
+public:
+    JobDeque( ) : top( 0 ), bottom( 0 )
+    {
+    }
+
+    // Owner only. False when the deque is full, nothing is written then.
+    bool Push( const Job &job )
+    {
+        std::ptrdiff_t b = this->bottom.load( std::memory_order_relaxed );
+        std::ptrdiff_t t = this->top.load( std::memory_order_acquire );
+        if ( b - t >= ( std::ptrdiff_t )CAPACITY )
+        {
+            return false;
+        }
+        this->slots[b & MASK].Store( job );
+        // Publishes the job to thieves, who read the bottom with acquire
+        this->bottom.store( b + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Owner only, copies the newest job into 'job', false when there was none
+    bool Pop( Job &job )
+    {
+        std::ptrdiff_t b = this->bottom.load( std::memory_order_relaxed ) - 1;
+        this->bottom.store( b, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        std::ptrdiff_t t = this->top.load( std::memory_order_relaxed );
+        if ( t > b )
+        {
+            this->bottom.store( b + 1, std::memory_order_relaxed );
+            return false;
+        }
+
+        this->slots[b & MASK].Load( job );
+        if ( t == b )
+        {
+            // The last job, a thief may be taking it at the same time
+            bool won = this->top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed );
+            this->bottom.store( b + 1, std::memory_order_relaxed );
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread, copies the oldest job into 'job', false when there is none or another thread won it
+    bool Steal( Job &job )
+    {
+        std::ptrdiff_t t = this->top.load( std::memory_order_acquire );
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        std::ptrdiff_t b = this->bottom.load( std::memory_order_acquire );
+        if ( t >= b )
+        {
+            return false;
+        }
+
+        // Only whole when the swap succeeds, see above
+        this->slots[t & MASK].Load( job );
+        return this->top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed );
+    }
+
+private:
+    static const GLuint CAPACITY = 4096;
+    static const GLuint MASK = CAPACITY - 1;
+
+    // A Job with every field atomic, written and read relaxed; the bottom and the top order them
+    struct Slot
+    {
+        std::atomic<void ( * )( const Job &job )> function;
+        std::atomic<const void *> data;
+        std::atomic<size_t> begin;
+        std::atomic<size_t> end;
+        std::atomic<size_t> chunk;
+        std::atomic<JobCounter *> counter;
+
+        void Store( const Job &job )
+        {
+            this->function.store( job.function, std::memory_order_relaxed );
+            this->data.store( job.data, std::memory_order_relaxed );
+            this->begin.store( job.begin, std::memory_order_relaxed );
+            this->end.store( job.end, std::memory_order_relaxed );
+            this->chunk.store( job.chunk, std::memory_order_relaxed );
+            this->counter.store( job.counter, std::memory_order_relaxed );
+        }
+
+        void Load( Job &job ) const
+        {
+            job.function = this->function.load( std::memory_order_relaxed );
+            job.data = this->data.load( std::memory_order_relaxed );
+            job.begin = this->begin.load( std::memory_order_relaxed );
+            job.end = this->end.load( std::memory_order_relaxed );
+            job.chunk = this->chunk.load( std::memory_order_relaxed );
+            job.counter = this->counter.load( std::memory_order_relaxed );
+        }
+    };
+
+    // Apart, so thieves writing the top don't keep taking the owner's cache line
+    alignas( 64 ) std::atomic<std::ptrdiff_t> top;
+    alignas( 64 ) std::atomic<std::ptrdiff_t> bottom;
+    Slot slots[CAPACITY];
+};
+
+// Runs jobs on a thread per core: the thread that creates the system is worker 0 and the others are started for it. Every
+// worker has a deque of its own, runs its newest job first and, when it has none, steals the oldest of another one. A worker
+// waiting for a fork/join runs jobs until the counter drops to zero instead of blocking, so nested parallel fors can't run
+// out of threads. Idle workers sleep until a job is pushed.
+//
+// ParallelFor splits a range lazily: a job for more than a chunk pushes its upper half for others to steal and goes on with
+// the lower half, so a range is only cut as finely as idle workers ask for.
+class JobSystem
+{
+public:
+    // Starts 'threads' - 1 workers next to the calling thread, at least one thread in all. 'attachable' more threads, which
+    // run loops of their own, can join with AttachThread.
+    explicit JobSystem( GLuint threads, GLuint attachable = 0 )
+        : workers( ( ( threads > 0 ) ? threads : 1 ) + attachable ), attached( ( threads > 0 ) ? threads : 1 ), queued( 0 ), sleeping( 0 ), stop( false )
+    {
+        workerIndex( ) = 0;
+        for ( GLuint i = 1; i < this->attached; i++ )
+        {
+            this->threads.push_back( std::thread( &JobSystem::workerLoop, this, i ) );
+        }
+    }
+
+    ~JobSystem( )
+    {
+        {
+            std::lock_guard<std::mutex> lock( this->mutex );
+            this->stop = true;
+        }
+        this->wake.notify_all( );
+        for ( size_t i = 0; i < this->threads.size( ); i++ )
+        {
+            this->threads[i].join( );
+        }
+        workerIndex( ) = INVALID;
+    }
+
+    GLuint GetThreadCount( ) const
+    {
+        return ( GLuint )this->workers.size( );
+    }
+
+    // Makes the calling thread a worker like the one that created the system: it gets a deque, its parallel fors are split
+    // over every worker and it runs jobs while it waits for them. Threads past the 'attachable' ones stay outside and run
+    // their jobs themselves.
+    void AttachThread( )
+    {
+        GLuint index = this->attached.fetch_add( 1, std::memory_order_relaxed );
+        if ( index < this->workers.size( ) )
+        {
+            workerIndex( ) = index;
+        }
+    }
+
+    // Before an attached thread ends
+    void DetachThread( )
+    {
+        workerIndex( ) = INVALID;
+    }
+
+    // Queues 'function' on the items [begin, end) reporting to 'counter', ranges over 'chunk' items are split. Only workers
+    // queue jobs, any other thread runs the job right away.
+    void Run( void ( *function )( const Job &job ), const void *data, size_t begin, size_t end, size_t chunk, JobCounter &counter )
+    {
+        GLuint index = workerIndex( );
+        Job job = { function, data, begin, end, chunk, &counter };
+        counter.pending.fetch_add( 1, std::memory_order_relaxed );
+        if ( INVALID == index )
+        {
+            this->finish( job );
+            return;
+        }
+
+        Worker &worker = this->workers[index];
+        if ( !worker.deque.Push( job ) )
+        {
+            this->finish( job );
+            return;
+        }
+        this->queued.fetch_add( 1, std::memory_order_seq_cst );
+        if ( this->sleeping.load( std::memory_order_seq_cst ) > 0 )
+        {
+            std::lock_guard<std::mutex> lock( this->mutex );
+            this->wake.notify_one( );
+        }
+    }
+
+    // Runs jobs until every job of 'counter' has finished. When there are none left to run it sleeps until the last one of
+    // the counter finishes or another is pushed.
+    void Wait( JobCounter &counter )
+    {
+        GLuint index = workerIndex( );
+        GLuint idle = 0;
+        while ( counter.pending.load( std::memory_order_acquire ) > 0 )
+        {
+            if ( INVALID != index && this->runOne( index ) )
+            {
+                idle = 0;
+            }
+            else if ( ++idle < IDLE_SPINS )
+            {
+                std::this_thread::yield( );
+            }
+            else
+            {
+                std::unique_lock<std::mutex> lock( this->mutex );
+                this->sleeping.fetch_add( 1, std::memory_order_seq_cst );
+                while ( counter.pending.load( std::memory_order_seq_cst ) > 0 && this->queued.load( std::memory_order_seq_cst ) <= 0 )
+                {
+                    this->wake.wait( lock );
+                }
+                this->sleeping.fetch_sub( 1, std::memory_order_seq_cst );
+                idle = 0;
+            }
+        }
+    }
+
+    // Calls function( begin, end ) on ranges covering [0, count) and returns when all are done. Ranges start on multiples of
+    // 'chunk' items and are at least that long, except for the last one; it should be enough work to outweigh a steal and
+    // a multiple of the lane width when the function works on lanes.
+    template <typename Function>
+    void ParallelFor( size_t count, size_t chunk, const Function &function )
+    {
+        if ( count <= chunk || 1 == this->workers.size( ) )
+        {
+            if ( count > 0 )
+            {
+                function( ( size_t )0, count );
+            }
+            return;
+        }
+
+        // Enough pieces for every worker to steal a few, so uneven ranges even out
+        size_t pieces = this->workers.size( ) * PIECES_PER_WORKER;
+        size_t size = ( count + pieces - 1 ) / pieces;
+        size = ( size + chunk - 1 ) / chunk * chunk;
+        JobCounter counter;
+        this->Run( &JobSystem::runRange<Function>, &function, 0, count, size, counter );
+        this->Wait( counter );
+    }
+
+private:
+    static const GLuint INVALID = 0xFFFFFFFF;
+    static const GLuint PIECES_PER_WORKER = 4;
+    static const GLuint IDLE_SPINS = 64;
+
+    struct Worker
+    {
+        JobDeque deque;
+        // Where to look for work to steal first
+        GLuint victim;
+
+        Worker( ) : victim( 0 )
+        {
+        }
+    };
+
+    std::vector<Worker> workers;
+    std::vector<std::thread> threads;
+    // Workers handed out, started ones and attached threads
+    std::atomic<GLuint> attached;
+    // Jobs in the deques, for idle workers to tell whether to sleep
+    std::atomic<GLint> queued;
+    std::atomic<GLint> sleeping;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stop;
+
+    // Worker the calling thread is, INVALID for threads not of a job system
+    static GLuint &workerIndex( )
+    {
+        static thread_local GLuint index = INVALID;
+        return index;
+    }
+
+    // Splits off the upper half of the range until it fits a chunk, then runs it
+    template <typename Function>
+    static void runRange( const Job &job )
+    {
+        size_t begin = job.begin, end = job.end;
+        while ( end - begin > job.chunk )
+        {
+            size_t middle = begin + ( end - begin + 2 * job.chunk - 1 ) / ( 2 * job.chunk ) * job.chunk;
+            currentSystem( )->Run( &JobSystem::runRange<Function>, job.data, middle, end, job.chunk, *job.counter );
+            end = middle;
+        }
+        ( *static_cast<const Function *>( job.data ) )( begin, end );
+    }
+
+    // System of the job the calling thread is running
+    static JobSystem *&currentSystem( )
+    {
+        static thread_local JobSystem *system = NULL;
+        return system;
+    }
+
+    void finish( const Job &job )
+    {
+        JobSystem *previous = currentSystem( );
+        currentSystem( ) = this;
+        job.function( job );
+        currentSystem( ) = previous;
+        // The last job of a counter wakes the threads sleeping in Wait for it
+        if ( 1 == job.counter->pending.fetch_sub( 1, std::memory_order_seq_cst ) && this->sleeping.load( std::memory_order_seq_cst ) > 0 )
+        {
+            std::lock_guard<std::mutex> lock( this->mutex );
+            this->wake.notify_all( );
+        }
+    }
+
+    // Runs the newest job of the worker or one stolen from another, false when there was none
+    bool runOne( GLuint index )
+    {
+        Worker &worker = this->workers[index];
+        Job job;
+        bool found = worker.deque.Pop( job );
+        GLuint count = this->GetThreadCount( );
+        for ( GLuint i = 0; !found && i < count; i++ )
+        {
+            GLuint victim = ( worker.victim + i ) % count;
+            if ( victim != index && this->workers[victim].deque.Steal( job ) )
+            {
+                worker.victim = victim;
+                found = true;
+            }
+        }
+        if ( !found )
+        {
+            return false;
+        }
+
+        this->queued.fetch_sub( 1, std::memory_order_relaxed );
+        this->finish( job );
+        return true;
+    }
+
+    void workerLoop( GLuint index )
+    {
+        workerIndex( ) = index;
+        for ( ;; )
+        {
+            if ( this->runOne( index ) )
+            {
+                continue;
+            }
+
+            // Spin a little before sleeping, fork/joins come in bursts within a frame
+            bool found = false;
+            for ( GLuint spin = 0; spin < IDLE_SPINS && !found; spin++ )
+            {
+                std::this_thread::yield( );
+                found = this->queued.load( std::memory_order_relaxed ) > 0;
+            }
+            if ( found )
+            {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock( this->mutex );
+            this->sleeping.fetch_add( 1, std::memory_order_seq_cst );
+            while ( !this->stop && this->queued.load( std::memory_order_seq_cst ) <= 0 )
+            {
+                this->wake.wait( lock );
+            }
+            this->sleeping.fetch_sub( 1, std::memory_order_seq_cst );
+            if ( this->stop )
+            {
+                return;
+            }
+        }
+    }
+};
@@ -0,0 +1,176 @@
+#pragma once
+
+// Std. Includes
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "GLState.h"
+
+// Number of point lights in the Lights uniform block, has to match NUMBER_OF_POINT_LIGHTS in lighting.frag
+const GLuint NUMBER_OF_POINT_LIGHTS = 14;
+
+// Uniform buffer binding point the Lights block is attached to
+const GLuint LIGHTS_BINDING_POINT = 0;
+
+// Texture unit of the point light texture buffer, 0 and 1 hold the material maps
+const GLuint POINT_LIGHT_UNIT = 4;
+
+// C++ mirrors of the light structs in lighting.frag laid out with the std140 rules.
+// A vec3 is aligned to 16 bytes, so every vec3 is followed by one float (or padding) to fill its slot.
+struct DirLightData
+{
+    glm::vec3 direction;
+    GLfloat pad0;
+    glm::vec3 ambient;
+    GLfloat pad1;
+    glm::vec3 diffuse;
+    GLfloat pad2;
+    glm::vec3 specular;
+    GLfloat pad3;
+};
+
+struct PointLightData
+{
+    glm::vec3 position;
+    GLfloat constant;
+    glm::vec3 ambient;
+    GLfloat linear;
+    glm::vec3 diffuse;
+    GLfloat quadratic;
+    glm::vec3 specular;
+    GLfloat pad0;
+};
+
+struct SpotLightData
+{
+    glm::vec3 position;
+    GLfloat cutOff;
+    glm::vec3 direction;
+    GLfloat outerCutOff;
+    glm::vec3 ambient;
+    GLfloat constant;
+    glm::vec3 diffuse;
+    GLfloat linear;
+    glm::vec3 specular;
+    GLfloat quadratic;
+};
+
+// Mirror of the whole 'Lights' uniform block
+struct LightBlock
+{
+    DirLightData dirLight;
+    PointLightData pointLights[NUMBER_OF_POINT_LIGHTS];
+    SpotLightData spotLight;
+};
+
+static_assert( sizeof( DirLightData ) == 64, "DirLightData does not match the std140 layout" );
+static_assert( sizeof( PointLightData ) == 64, "PointLightData does not match the std140 layout" );
+static_assert( sizeof( SpotLightData ) == 80, "SpotLightData does not match the std140 layout" );
+static_assert( offsetof( LightBlock, pointLights ) == 64, "LightBlock does not match the std140 layout" );
+static_assert( offsetof( LightBlock, spotLight ) == 64 + 64 * NUMBER_OF_POINT_LIGHTS, "LightBlock does not match the std140 layout" );
+
+// Owns the uniform buffer behind the 'Lights' block. The block is uploaded once and afterwards only the ranges that change are re-sent.
+class LightBuffer
+{
+public:
+    // CPU copy of the block, edit it and then call one of the upload functions
+    LightBlock Data;
+
+    // Constructor creates the buffer and attaches it to LIGHTS_BINDING_POINT
+    LightBuffer( ) : Data( )
+    {
+        glGenBuffers( 1, &this->UBO );
+        GLState::Get( ).BindBuffer( GL_UNIFORM_BUFFER, this->UBO );
+        glBufferData( GL_UNIFORM_BUFFER, sizeof( LightBlock ), NULL, GL_DYNAMIC_DRAW );
+        GLState::Get( ).BindBufferBase( GL_UNIFORM_BUFFER, LIGHTS_BINDING_POINT, this->UBO );
+    }
+
+    // Frees the buffer, has to be called while the context is still alive
+    void Delete( )
+    {
+        glDeleteBuffers( 1, &this->UBO );
+    }
+
+    // Uploads the whole block
+    void Upload( )
+    {
+        this->uploadRange( 0, sizeof( LightBlock ), &this->Data );
+    }
+
+    // Moves the spot light, the buffer is only touched when the position or direction actually changed
+    void SetSpotLight( glm::vec3 position, glm::vec3 direction )
+    {
+        if ( position == this->Data.spotLight.position && direction == this->Data.spotLight.direction )
+        {
+            return;
+        }
+
+        this->Data.spotLight.position = position;
+        this->Data.spotLight.direction = direction;
+        this->uploadRange( offsetof( LightBlock, spotLight ), sizeof( SpotLightData ), &this->Data.spotLight );
+    }
+
+private:
+    GLuint UBO;
+
+    void uploadRange( GLintptr offset, GLsizeiptr size, const GLvoid *data )
+    {
+        GLState::Get( ).BindBuffer( GL_UNIFORM_BUFFER, this->UBO );
+        glBufferSubData( GL_UNIFORM_BUFFER, offset, size, data );
+    }
+};
+
+// Texture buffer holding any number of point lights as four RGBA32F texels each, the same layout as PointLightData.
+// The clustered and the deferred pipelines read their lights from here instead of the fixed size uniform block.
+class PointLightBuffer
+{
+public:
+    PointLightBuffer( ) : count( 0 )
+    {
+        glGenBuffers( 1, &this->buffer );
+        glGenTextures( 1, &this->texture );
+        GLState::Get( ).BindBuffer( GL_TEXTURE_BUFFER, this->buffer );
+        glBufferData( GL_TEXTURE_BUFFER, sizeof( PointLightData ), NULL, GL_STATIC_DRAW );
+        GLState::Get( ).BindTexture( 0, GL_TEXTURE_BUFFER, this->texture );
+        glTexBuffer( GL_TEXTURE_BUFFER, GL_RGBA32F, this->buffer );
+        GLState::Get( ).BindTexture( 0, GL_TEXTURE_BUFFER, 0 );
+    }
+
+    // Frees the buffer, has to be called while the context is still alive
+    void Delete( )
+    {
+        glDeleteTextures( 1, &this->texture );
+        glDeleteBuffers( 1, &this->buffer );
+    }
+
+    // Replaces the whole light list
+    void Upload( const std::vector<PointLightData> &lights )
+    {
+        this->count = ( GLuint )lights.size( );
+        GLState::Get( ).BindBuffer( GL_TEXTURE_BUFFER, this->buffer );
+        glBufferData( GL_TEXTURE_BUFFER, std::max<size_t>( lights.size( ), 1 ) * sizeof( PointLightData ), lights.empty( ) ? NULL : lights.data( ), GL_STATIC_DRAW );
+    }
+
+    // Binds the texture buffer to POINT_LIGHT_UNIT
+    void Bind( )
+    {
+        GLState::Get( ).BindTexture( POINT_LIGHT_UNIT, GL_TEXTURE_BUFFER, this->texture );
+    }
+
+    GLuint GetCount( ) const
+    {
+        return this->count;
+    }
+
+private:
+    GLuint buffer;
+    GLuint texture;
+    GLuint count;
+};
@@ -0,0 +1,344 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "BufferArena.h"
+
+// Turns triangle lists into indexed meshes that are cheap for the GPU to fetch and transform. Vertices that are identical bit
+// for bit are welded into one, triangles can be reordered so the post-transform cache hits more often (Tom Forsyth's linear
+// speed optimizer), and vertices reordered into the order the triangles first use them, so fetches walk the vertex buffer
+// forward. Vertices are any number of floats; only their bits are compared, so -0 and 0 stay apart.
+class MeshOptimizer
+{
+public:
+    // Size of the FIFO cache ACMR is measured against, close to what GPUs of the GL 3.3 era had
+    static const GLuint FIFO_CACHE_SIZE = 16;
+
+    MeshOptimizer( ) : vertexFloats( 0 )
+    {
+    }
+
+    // Welds a non-indexed triangle list of 'count' vertices, 'vertexFloats' floats each
+    void LoadTriangles( const GLfloat *vertices, GLuint count, GLuint vertexFloats )
+    {
+        std::vector<GLuint> indices( count );
+        for ( GLuint i = 0; i < count; i++ )
+        {
+            indices[i] = i;
+        }
+        this->LoadIndexed( vertices, count, indices.data( ), count, vertexFloats );
+    }
+
+    // Welds an indexed triangle list. Vertices no triangle uses are dropped, the order of the triangles is kept.
+    void LoadIndexed( const GLfloat *vertices, GLuint vertexCount, const GLuint *indices, GLuint indexCount, GLuint vertexFloats )
+    {
+        this->vertexFloats = vertexFloats;
+        this->vertices.clear( );
+        this->indices.resize( indexCount );
+
+        // Open addressing table of the welded vertices, kept at most half full
+        GLuint tableSize = 1;
+        while ( tableSize < 2 * vertexCount )
+        {
+            tableSize <<= 1;
+        }
+        std::vector<GLuint> table( tableSize, GLuint( EMPTY ) );
+        std::vector<GLuint> remap( vertexCount, GLuint( EMPTY ) );
+        for ( GLuint i = 0; i < indexCount; i++ )
+        {
+            GLuint source = indices[i];
+            if ( EMPTY == remap[source] )
+            {
+                remap[source] = this->weld( &vertices[source * vertexFloats], table );
+            }
+            this->indices[i] = remap[source];
+        }
+    }
+
+    // Reorders the triangles for the post-transform vertex cache. Each step emits the triangle whose vertices score highest:
+    // vertices recently used score by their position in a modelled LRU cache, and vertices with few triangles left get a
+    // boost so they are finished off instead of leaving lone triangles behind. Only the triangles of the vertices in the
+    // cache are rescored, when none of them is left the next triangle in the original order starts a new strip.
+    void OptimizeVertexCache( )
+    {
+        GLuint vertexCount = this->GetVertexCount( );
+        GLuint triangleCount = this->GetIndexCount( ) / 3;
+
+        // Remaining triangles of every vertex, in one array: those of vertex v start at first[v] and there are remaining[v]
+        std::vector<GLuint> first( vertexCount + 1, 0 ), remaining( vertexCount, 0 );
+        for ( size_t i = 0; i < this->indices.size( ); i++ )
+        {
+            remaining[this->indices[i]]++;
+        }
+        for ( GLuint v = 0; v < vertexCount; v++ )
+        {
+            first[v + 1] = first[v] + remaining[v];
+        }
+        std::vector<GLuint> triangles( this->indices.size( ) ), cursor( first.begin( ), first.end( ) - 1 );
+        for ( size_t i = 0; i < this->indices.size( ); i++ )
+        {
+            triangles[cursor[this->indices[i]]++] = ( GLuint )( i / 3 );
+        }
+
+        // Scores by cache position and by remaining triangles, vertices with more triangles than the table covers all score
+        // about the same
+        GLfloat positionScores[LRU_CACHE_SIZE], valenceScores[VALENCE_SCORES];
+        for ( GLuint position = 0; position < LRU_CACHE_SIZE; position++ )
+        {
+            positionScores[position] = ( position < 3 ) ? LAST_TRIANGLE_SCORE : std::pow( 1.0f - ( position - 3 ) / ( GLfloat )( LRU_CACHE_SIZE - 3 ), CACHE_DECAY_POWER );
+        }
+        valenceScores[0] = -1.0f;
+        for ( GLuint valence = 1; valence < VALENCE_SCORES; valence++ )
+        {
+            valenceScores[valence] = VALENCE_BOOST_SCALE * std::pow( ( GLfloat )valence, -VALENCE_BOOST_POWER );
+        }
+        std::vector<GLfloat> vertexScores( vertexCount );
+        for ( GLuint v = 0; v < vertexCount; v++ )
+        {
+            vertexScores[v] = valenceScores[( remaining[v] < VALENCE_SCORES ) ? remaining[v] : VALENCE_SCORES - 1];
+        }
+
+        std::vector<bool> emitted( triangleCount, false );
+        std::vector<GLuint> ordered;
+        ordered.reserve( this->indices.size( ) );
+        GLuint cache[LRU_CACHE_SIZE + 3], nextCache[LRU_CACHE_SIZE + 3];
+        GLuint cacheCount = 0;
+        GLuint scan = 0;
+        GLint best = -1;
+        while ( ordered.size( ) < this->indices.size( ) )
+        {
+            if ( best < 0 )
+            {
+                while ( emitted[scan] )
+                {
+                    scan++;
+                }
+                best = ( GLint )scan;
+            }
+
+            // Emit the triangle and drop it from the lists of its vertices
+            const GLuint *corners = &this->indices[3 * best];
+            emitted[best] = true;
+            for ( GLuint c = 0; c < 3; c++ )
+            {
+                GLuint v = corners[c];
+                ordered.push_back( v );
+                GLuint *list = &triangles[first[v]];
+                for ( GLuint i = 0; i < remaining[v]; i++ )
+                {
+                    if ( list[i] == ( GLuint )best )
+                    {
+                        list[i] = list[--remaining[v]];
+                        break;
+                    }
+                }
+            }
+
+            // Its vertices go to the front of the cache, the rest move back; three more than fit are kept for one step so
+            // the vertices pushed out get their scores lowered
+            GLuint nextCount = 0;
+            for ( GLuint c = 0; c < 3; c++ )
+            {
+                nextCache[nextCount++] = corners[c];
+            }
+            for ( GLuint i = 0; i < cacheCount; i++ )
+            {
+                GLuint v = cache[i];
+                if ( v != corners[0] && v != corners[1] && v != corners[2] )
+                {
+                    nextCache[nextCount++] = v;
+                }
+            }
+            cacheCount = nextCount;
+            for ( GLuint i = 0; i < cacheCount; i++ )
+            {
+                GLuint v = nextCache[i];
+                GLuint valence = ( remaining[v] < VALENCE_SCORES ) ? remaining[v] : VALENCE_SCORES - 1;
+                vertexScores[v] = ( 0 == valence || i >= LRU_CACHE_SIZE ) ? valenceScores[valence] : positionScores[i] + valenceScores[valence];
+            }
+
+            GLfloat bestScore = -1.0f;
+            best = -1;
+            for ( GLuint i = 0; i < cacheCount; i++ )
+            {
+                GLuint v = nextCache[i];
+                for ( GLuint j = first[v]; j < first[v] + remaining[v]; j++ )
+                {
+                    // The scores of vertices outside the cache were last set when they dropped out of it, and their triangle
+                    // counts can't have changed since
+                    GLuint t = triangles[j];
+                    GLfloat triangleScore = vertexScores[this->indices[3 * t]] + vertexScores[this->indices[3 * t + 1]] + vertexScores[this->indices[3 * t + 2]];
+                    if ( triangleScore > bestScore )
+                    {
+                        bestScore = triangleScore;
+                        best = ( GLint )t;
+                    }
+                }
+            }
+            cacheCount = ( cacheCount < LRU_CACHE_SIZE ) ? cacheCount : LRU_CACHE_SIZE;
+            std::memcpy( cache, nextCache, cacheCount * sizeof( GLuint ) );
+        }
+        this->indices.swap( ordered );
+    }
+
+    // Renumbers the vertices in the order the triangles first use them
+    void OptimizeVertexFetch( )
+    {
+        std::vector<GLuint> remap( this->GetVertexCount( ), GLuint( EMPTY ) );
+        std::vector<GLfloat> ordered( this->vertices.size( ) );
+        GLuint next = 0;
+        for ( size_t i = 0; i < this->indices.size( ); i++ )
+        {
+            GLuint v = this->indices[i];
+            if ( EMPTY == remap[v] )
+            {
+                std::memcpy( &ordered[next * this->vertexFloats], &this->vertices[v * this->vertexFloats], this->vertexFloats * sizeof( GLfloat ) );
+                remap[v] = next++;
+            }
+            this->indices[i] = remap[v];
+        }
+        ordered.resize( next * this->vertexFloats );
+        this->vertices.swap( ordered );
+    }
+
+    // Average cache miss ratio: vertices transformed per triangle with a FIFO post-transform cache of 'cacheSize' entries.
+    // 3 for a non-indexed mesh, 0.5 is the limit for a large regular grid.
+    GLfloat GetACMR( GLuint cacheSize = FIFO_CACHE_SIZE ) const
+    {
+        if ( this->indices.empty( ) )
+        {
+            return 0.0f;
+        }
+
+        // A vertex is in the cache if it went in during one of the last 'cacheSize' misses
+        std::vector<GLuint> insertedAt( this->GetVertexCount( ), 0 );
+        GLuint misses = 0;
+        for ( size_t i = 0; i < this->indices.size( ); i++ )
+        {
+            GLuint v = this->indices[i];
+            if ( 0 == insertedAt[v] || insertedAt[v] + cacheSize <= misses )
+            {
+                insertedAt[v] = ++misses;
+            }
+        }
+        return misses / ( this->indices.size( ) / 3.0f );
+    }
+
+    // 16 bit indices whenever they can reach every vertex
+    GLenum GetIndexType( ) const
+    {
+        return ( this->GetVertexCount( ) <= 65536 ) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
+
+    // Copies the positions, the first three floats of every vertex, into a range of 'arena'. They are tightly packed so passes
+    // that only read positions fetch nothing else, and the range starts on a whole vertex so it can be drawn with a base
+    // vertex from the start of the arena.
+    BufferRange UploadPositions( BufferArena &arena ) const
+    {
+        return this->uploadStream( arena, 0, 3 );
+    }
+
+    // Copies the floats after the position of every vertex into a range of 'arena'
+    BufferRange UploadAttributes( BufferArena &arena ) const
+    {
+        return this->uploadStream( arena, 3, this->vertexFloats - 3 );
+    }
+
+    // Copies the indices into a range of 'arena', in the type GetIndexType returns
+    BufferRange UploadIndices( BufferArena &arena ) const
+    {
+        if ( GL_UNSIGNED_SHORT == this->GetIndexType( ) )
+        {
+            std::vector<GLushort> shortIndices( this->indices.begin( ), this->indices.end( ) );
+            return arena.Upload( shortIndices.data( ), ( GLuint )( shortIndices.size( ) * sizeof( GLushort ) ), sizeof( GLushort ) );
+        }
+        return arena.Upload( this->indices.data( ), ( GLuint )( this->indices.size( ) * sizeof( GLuint ) ), sizeof( GLuint ) );
+    }
+
+    const std::vector<GLfloat> &GetVertices( ) const
+    {
+        return this->vertices;
+    }
+
+    const std::vector<GLuint> &GetIndices( ) const
+    {
+        return this->indices;
+    }
+
+    GLuint GetVertexCount( ) const
+    {
+        return ( 0 == this->vertexFloats ) ? 0 : ( GLuint )( this->vertices.size( ) / this->vertexFloats );
+    }
+
+    GLuint GetIndexCount( ) const
+    {
+        return ( GLuint )this->indices.size( );
+    }
+
+private:
+    static const GLuint EMPTY = 0xFFFFFFFF;
+    // Cache modelled by the triangle ordering and the weights of Forsyth's scoring
+    static const GLuint LRU_CACHE_SIZE = 32;
+    static constexpr GLfloat CACHE_DECAY_POWER = 1.5f;
+    static constexpr GLfloat LAST_TRIANGLE_SCORE = 0.75f;
+    static constexpr GLfloat VALENCE_BOOST_SCALE = 2.0f;
+    static constexpr GLfloat VALENCE_BOOST_POWER = 0.5f;
+    static const GLuint VALENCE_SCORES = 32;
+
+    GLuint vertexFloats;
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+
+    // Uploads 'floats' floats of every vertex starting at float 'first'
+    BufferRange uploadStream( BufferArena &arena, GLuint first, GLuint floats ) const
+    {
+        std::vector<GLfloat> stream( this->GetVertexCount( ) * floats );
+        for ( GLuint i = 0; i < this->GetVertexCount( ); i++ )
+        {
+            std::memcpy( &stream[i * floats], &this->vertices[i * this->vertexFloats + first], floats * sizeof( GLfloat ) );
+        }
+        return arena.Upload( stream.data( ), ( GLuint )( stream.size( ) * sizeof( GLfloat ) ), floats * sizeof( GLfloat ) );
+    }
+
+    // Index of the welded vertex equal to 'vertex', added if there is none yet
+    GLuint weld( const GLfloat *vertex, std::vector<GLuint> &table )
+    {
+        // FNV-1a over the bits of the floats, a float at a time. Round coordinates leave the low mantissa bits at zero, so the
+        // low bits the table is indexed with would hardly vary without the final mix (MurmurHash3's).
+        uint32_t hash = 2166136261u;
+        for ( GLuint i = 0; i < this->vertexFloats; i++ )
+        {
+            uint32_t bits;
+            std::memcpy( &bits, &vertex[i], sizeof( bits ) );
+            hash = ( hash ^ bits ) * 16777619u;
+        }
+        hash ^= hash >> 16;
+        hash *= 0x85EBCA6Bu;
+        hash ^= hash >> 13;
+        hash *= 0xC2B2AE35u;
+        hash ^= hash >> 16;
+
+        GLuint mask = ( GLuint )table.size( ) - 1;
+        for ( GLuint slot = hash & mask; ; slot = ( slot + 1 ) & mask )
+        {
+            if ( EMPTY == table[slot] )
+            {
+                table[slot] = this->GetVertexCount( );
+                this->vertices.insert( this->vertices.end( ), vertex, vertex + this->vertexFloats );
+                return table[slot];
+            }
+            if ( 0 == std::memcmp( &this->vertices[table[slot] * this->vertexFloats], vertex, this->vertexFloats * sizeof( GLfloat ) ) )
+            {
+                return table[slot];
+            }
+        }
+    }
+};
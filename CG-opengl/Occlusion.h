@@ -0,0 +1,140 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "GLState.h"
+#include "Transforms.h"
+
+constexpr GLuint UNIFORM_BOX_MIN = UniformHash( "boxMin" );
+constexpr GLuint UNIFORM_BOX_MAX = UniformHash( "boxMax" );
+constexpr GLuint UNIFORM_VIEW_PROJECTION = UniformHash( "viewProjection" );
+
+// Hardware occlusion culling for a group of objects, e.g. the falling cubes. At the end of a frame the box of every object
+// is drawn against the frame's depth inside a GL_ANY_SAMPLES_PASSED query, and in the next frame the object is drawn under
+// glBeginConditionalRender on that query. The GPU skips the draw when none of the box was visible; with GL_QUERY_NO_WAIT a
+// result that isn't ready yet just lets the draw through, so neither the CPU nor the GPU ever waits on a query. An object
+// that comes out from behind an occluder shows up one frame late.
+class OcclusionCuller
+{
+public:
+    OcclusionCuller( ) : frame( 1 ), tested( 0 ), culled( 0 )
+    {
+    }
+
+    // Frees the queries, has to be called while the context is still alive
+    void Delete( )
+    {
+        if ( !this->queries.empty( ) )
+        {
+            glDeleteQueries( ( GLsizei )this->queries.size( ), this->queries.data( ) );
+        }
+    }
+
+    // Starts a frame of a group of 'count' objects. Results of last frame's queries that are already available are counted,
+    // the ones that aren't are left to the GPU.
+    void BeginFrame( GLuint count )
+    {
+        this->frame++;
+        if ( count > this->queries.size( ) )
+        {
+            size_t first = this->queries.size( );
+            this->queries.resize( count );
+            this->issued.resize( count, 0 );
+            glGenQueries( ( GLsizei )( count - first ), &this->queries[first] );
+        }
+
+        this->tested = 0;
+        this->culled = 0;
+        for ( GLuint i = 0; i < this->queries.size( ); i++ )
+        {
+            if ( this->issued[i] + 1 != this->frame )
+            {
+                continue;
+            }
+
+            GLuint available;
+            glGetQueryObjectuiv( this->queries[i], GL_QUERY_RESULT_AVAILABLE, &available );
+            if ( available )
+            {
+                GLuint passed;
+                glGetQueryObjectuiv( this->queries[i], GL_QUERY_RESULT, &passed );
+                this->tested++;
+                this->culled += passed ? 0 : 1;
+            }
+        }
+    }
+
+    // Query to condition the draw of an object on, 0 when its box wasn't tested last frame and it has to be drawn anyway
+    GLuint GetCondition( GLuint object ) const
+    {
+        return ( object < this->issued.size( ) && this->issued[object] + 1 == this->frame ) ? this->queries[object] : 0;
+    }
+
+    // Tests the boxes of the listed objects, instances of the unit cube scaled by 'size', against the depth buffer. Call once
+    // per frame after everything that can hide them has been drawn.
+    void IssueQueries( const std::vector<GLuint> &objects, const TransformSystem &transforms, GLfloat size, const glm::mat4 &viewProjection, glm::vec3 eye, Shader &proxyShader, GLuint emptyVAO )
+    {
+        // The boxes are a bit larger than the objects so they aren't hidden by the depth the objects themselves wrote
+        glm::vec3 halfSize( 0.5f * size * PROXY_SCALE );
+
+        glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+        glDepthMask( GL_FALSE );
+        glDepthFunc( GL_LEQUAL );
+        proxyShader.Use( );
+        proxyShader.SetMat4( UNIFORM_VIEW_PROJECTION, viewProjection );
+        GLState::Get( ).BindVertexArray( emptyVAO );
+        for ( size_t i = 0; i < objects.size( ); i++ )
+        {
+            GLuint object = objects[i];
+            glm::vec3 min = transforms.GetPosition( object ) - halfSize, max = transforms.GetPosition( object ) + halfSize;
+
+            // From inside the box its faces are behind the object, which would look occluded; it's drawn unconditionally next frame
+            bool inside = eye.x > min.x && eye.y > min.y && eye.z > min.z && eye.x < max.x && eye.y < max.y && eye.z < max.z;
+            if ( object >= this->queries.size( ) || inside )
+            {
+                continue;
+            }
+
+            proxyShader.SetVec3( UNIFORM_BOX_MIN, min );
+            proxyShader.SetVec3( UNIFORM_BOX_MAX, max );
+            glBeginQuery( GL_ANY_SAMPLES_PASSED, this->queries[object] );
+            glDrawArrays( GL_TRIANGLE_STRIP, 0, 14 );
+            glEndQuery( GL_ANY_SAMPLES_PASSED );
+            this->issued[object] = this->frame;
+        }
+        glDepthFunc( GL_LESS );
+        glDepthMask( GL_TRUE );
+        glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+    }
+
+    // Objects whose query from the previous frame was available at the start of this one
+    GLuint GetTested( ) const
+    {
+        return this->tested;
+    }
+
+    // Of those, the ones whose box had no visible sample, and whose draws the GPU skips this frame
+    GLuint GetCulled( ) const
+    {
+        return this->culled;
+    }
+
+private:
+    // Box size relative to the object it stands for
+    static constexpr GLfloat PROXY_SCALE = 1.05f;
+
+    std::vector<GLuint> queries;
+    // Frame in which each query was last issued
+    std::vector<GLuint> issued;
+    GLuint frame;
+    GLuint tested;
+    GLuint culled;
+};
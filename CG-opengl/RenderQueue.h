@@ -0,0 +1,251 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "Shader.h"
+#include "GLState.h"
+#include "Instancing.h"
+
+// Passes of a frame. The pass is the top of the sort key, so each pass is one contiguous run of the sorted queue.
+enum RenderPass
+{
+    // Optional depth only pass over the opaque geometry, so the lit pass shades each pixel once
+    PASS_DEPTH,
+    // Opaque lit geometry, drawn into the G-buffer in deferred mode
+    PASS_GEOMETRY,
+    // Unlit lamps, always drawn forward after the lighting
+    PASS_LAMPS
+};
+
+// Textures a packet binds to units 0, 1, ... Up to 4 per set
+const GLuint TEXTURE_SET_SIZE = 4;
+
+// Everything needed to issue one instanced draw
+struct DrawPacket
+{
+    Shader *shader;
+    GLuint VAO;
+    // Index returned by RenderQueue::AddTextureSet, 0 binds nothing
+    GLuint textureSet;
+    GLenum mode;
+    GLint first;
+    GLsizei count;
+    GLsizei instanceCount;
+    // When drawCount is set the packet draws these ranges of a single instance with glMultiDrawArrays instead of first/count.
+    // The arrays have to stay alive until the queue has been executed.
+    const GLint *firsts;
+    const GLsizei *counts;
+    GLsizei drawCount;
+    // Instance buffer of the VAO, when set the draw starts at instance firstInstance of it
+    InstanceBuffer *instances;
+    GLuint firstInstance;
+    // Occlusion query the draw is conditioned on, 0 draws unconditionally
+    GLuint condition;
+    // Type of the indices in the element buffer of the VAO, 0 for non-indexed draws. Indexed packets count first, count and
+    // the ranges in indices instead of vertices.
+    GLenum indexType;
+    // VAO of the same mesh reading only its position stream, for passes that need nothing else. 0 when VAO already is one.
+    GLuint positionVAO;
+    // Where an indexed mesh sits in shared buffers: the byte offset of its indices, which first and the ranges count from,
+    // and the vertex its indices count from
+    GLuint indexOffset;
+    GLint baseVertex;
+};
+
+// Collects the draws of a frame and issues them sorted by a 64 bit key, from the top bit down:
+//   pass (4) | program (8) | texture set (8) | VAO (8) | depth (24) | unused (12)
+// Draws sharing state end up next to each other, so GLState drops most of their binds, and draws with the same state run
+// front to back so the depth test rejects hidden fragments before they are shaded. Program and VAO take the low 8 bits of
+// their GL names; two objects that collide there only lose grouping, the packet still carries the real state.
+class RenderQueue
+{
+public:
+    RenderQueue( ) : farPlane( 100.0f )
+    {
+        // Set 0 is the empty one
+        this->textureSets.push_back( TextureSet( ) );
+    }
+
+    // Registers textures bound to units 0..count-1 by packets using the returned set
+    GLuint AddTextureSet( const GLuint *textures, GLuint count )
+    {
+        TextureSet set;
+        set.count = std::min( count, TEXTURE_SET_SIZE );
+        std::copy( textures, textures + set.count, set.textures );
+        this->textureSets.push_back( set );
+        return ( GLuint )this->textureSets.size( ) - 1;
+    }
+
+    // Empties the queue for a new frame, 'farPlane' is the distance mapped to the largest depth key
+    void Clear( GLfloat farPlane )
+    {
+        this->farPlane = farPlane;
+        this->packets.clear( );
+        this->items.clear( );
+    }
+
+    // Queues a draw, 'depth' is the distance from the camera used to order draws of equal state front to back
+    void Submit( RenderPass pass, GLfloat depth, const DrawPacket &packet )
+    {
+        if ( 0 == packet.instanceCount || ( 0 == packet.count && 0 == packet.drawCount ) )
+        {
+            return;
+        }
+
+        SortItem item;
+        item.key = this->makeKey( pass, depth, packet );
+        item.packet = ( GLuint )this->packets.size( );
+        this->packets.push_back( packet );
+        this->items.push_back( item );
+    }
+
+    // Sorts the queued draws by key, call once after every draw of the frame has been submitted
+    void Sort( )
+    {
+        this->scratch.resize( this->items.size( ) );
+
+        // Least significant digit radix sort, one pass per byte of the key. A byte that is the same in every key
+        // (the unused bits, or a single program) leaves the order alone, so its pass is skipped.
+        for ( GLuint shift = 0; shift < 64; shift += 8 )
+        {
+            size_t histogram[256] = { 0 };
+            for ( size_t i = 0; i < this->items.size( ); i++ )
+            {
+                histogram[( this->items[i].key >> shift ) & 0xFF]++;
+            }
+            if ( this->items.empty( ) || this->items.size( ) == histogram[( this->items[0].key >> shift ) & 0xFF] )
+            {
+                continue;
+            }
+
+            size_t offset = 0;
+            for ( GLuint digit = 0; digit < 256; digit++ )
+            {
+                size_t bucket = histogram[digit];
+                histogram[digit] = offset;
+                offset += bucket;
+            }
+            for ( size_t i = 0; i < this->items.size( ); i++ )
+            {
+                this->scratch[histogram[( this->items[i].key >> shift ) & 0xFF]++] = this->items[i];
+            }
+            this->items.swap( this->scratch );
+        }
+    }
+
+    // Issues the sorted draws of one pass. Per view uniforms have to be set on the shaders beforehand.
+    void Execute( RenderPass pass )
+    {
+        for ( size_t i = 0; i < this->items.size( ); i++ )
+        {
+            if ( ( GLuint )( this->items[i].key >> PASS_SHIFT ) != ( GLuint )pass )
+            {
+                continue;
+            }
+
+            const DrawPacket &packet = this->packets[this->items[i].packet];
+            packet.shader->Use( );
+            const TextureSet &set = this->textureSets[packet.textureSet];
+            for ( GLuint unit = 0; unit < set.count; unit++ )
+            {
+                GLState::Get( ).BindTexture( unit, GL_TEXTURE_2D, set.textures[unit] );
+            }
+            GLState::Get( ).BindVertexArray( packet.VAO );
+            if ( NULL != packet.instances )
+            {
+                packet.instances->SetFirstInstance( packet.VAO, packet.firstInstance );
+            }
+            if ( 0 != packet.condition )
+            {
+                glBeginConditionalRender( packet.condition, GL_QUERY_NO_WAIT );
+            }
+            if ( 0 != packet.indexType )
+            {
+                this->drawElements( packet );
+            }
+            else if ( packet.drawCount > 0 )
+            {
+                glMultiDrawArrays( packet.mode, packet.firsts, packet.counts, packet.drawCount );
+            }
+            else
+            {
+                glDrawArraysInstanced( packet.mode, packet.first, packet.count, packet.instanceCount );
+            }
+            if ( 0 != packet.condition )
+            {
+                glEndConditionalRender( );
+            }
+        }
+    }
+
+private:
+    static const GLuint PASS_SHIFT = 60;
+    static const GLuint PROGRAM_SHIFT = 52;
+    static const GLuint TEXTURE_SET_SHIFT = 44;
+    static const GLuint VAO_SHIFT = 36;
+    static const GLuint DEPTH_SHIFT = 12;
+    static const GLuint DEPTH_BITS = 24;
+
+    struct TextureSet
+    {
+        GLuint count;
+        GLuint textures[TEXTURE_SET_SIZE];
+
+        TextureSet( ) : count( 0 )
+        {
+        }
+    };
+
+    struct SortItem
+    {
+        uint64_t key;
+        GLuint packet;
+    };
+
+    GLfloat farPlane;
+    std::vector<TextureSet> textureSets;
+    std::vector<DrawPacket> packets;
+    std::vector<SortItem> items;
+    std::vector<SortItem> scratch;
+    // Byte offsets and base vertices of the ranges of an indexed multi-draw
+    std::vector<const GLvoid *> offsets;
+    std::vector<GLint> baseVertices;
+
+    void drawElements( const DrawPacket &packet )
+    {
+        size_t indexSize = ( GL_UNSIGNED_SHORT == packet.indexType ) ? 2 : ( GL_UNSIGNED_BYTE == packet.indexType ) ? 1 : 4;
+        if ( packet.drawCount > 0 )
+        {
+            this->offsets.resize( packet.drawCount );
+            this->baseVertices.assign( packet.drawCount, packet.baseVertex );
+            for ( GLsizei i = 0; i < packet.drawCount; i++ )
+            {
+                this->offsets[i] = ( const GLvoid * )( packet.indexOffset + packet.firsts[i] * indexSize );
+            }
+            glMultiDrawElementsBaseVertex( packet.mode, packet.counts, packet.indexType, this->offsets.data( ), packet.drawCount, this->baseVertices.data( ) );
+        }
+        else
+        {
+            glDrawElementsInstancedBaseVertex( packet.mode, packet.count, packet.indexType, ( const GLvoid * )( packet.indexOffset + packet.first * indexSize ), packet.instanceCount, packet.baseVertex );
+        }
+    }
+
+    uint64_t makeKey( RenderPass pass, GLfloat depth, const DrawPacket &packet ) const
+    {
+        GLfloat normalized = std::min( std::max( depth / this->farPlane, 0.0f ), 1.0f );
+        uint64_t depthKey = ( uint64_t )( normalized * ( ( 1u << DEPTH_BITS ) - 1 ) );
+
+        return ( ( uint64_t )( pass & 0xF ) << PASS_SHIFT )
+             | ( ( uint64_t )( packet.shader->Program & 0xFF ) << PROGRAM_SHIFT )
+             | ( ( uint64_t )( packet.textureSet & 0xFF ) << TEXTURE_SET_SHIFT )
+             | ( ( uint64_t )( packet.VAO & 0xFF ) << VAO_SHIFT )
+             | ( depthKey << DEPTH_SHIFT );
+    }
+};
@@ -5,15 +5,29 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <cstring>
 
 #include <GL/glew.h>
 
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "GLState.h"
+
+// FNV-1a hash of a uniform or uniform block name. It is constexpr so constant names can be hashed at compile time
+constexpr GLuint UniformHash( const GLchar *name, GLuint hash = 2166136261u )
+{
+    return ( '\0' == *name ) ? hash : UniformHash( name + 1, ( hash ^ ( GLuint )( unsigned char )*name ) * 16777619u );
+}
+
 class Shader
 {
 public:
     GLuint Program;
-    // Constructor generates the shader on the fly
-    Shader( const GLchar *vertexPath, const GLchar *fragmentPath )
+    // Constructor generates the shader on the fly, the optional defines are inserted right after the #version line of both stages
+    Shader( const GLchar *vertexPath, const GLchar *fragmentPath, const std::string &defines = "" )
     {
         // 1. Retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -43,6 +57,11 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
+        if ( !defines.empty( ) )
+        {
+            vertexCode.insert( vertexCode.find( '\n' ) + 1, defines );
+            fragmentCode.insert( fragmentCode.find( '\n' ) + 1, defines );
+        }
         const GLchar *vShaderCode = vertexCode.c_str( );
         const GLchar *fShaderCode = fragmentCode.c_str( );
         // 2. Compile shaders
@@ -86,12 +105,181 @@ public:
         // Delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader( vertex );
         glDeleteShader( fragment );
-        
+        // 3. Read back every active uniform and uniform block so no string lookups are needed later on
+        this->reflect( );
     }
-    // Uses the current shader
+    // Uses the current shader, nothing is sent to GL when it already is in use
     void Use( )
     {
-        glUseProgram( this->Program );
+        GLState::Get( ).UseProgram( this->Program );
+    }
+    // Returns the location of a uniform from its hashed name, -1 if the program has no such uniform
+    GLint GetUniformLocation( GLuint nameHash ) const
+    {
+        std::unordered_map<GLuint, GLint>::const_iterator it = this->uniforms.find( nameHash );
+        return ( it != this->uniforms.end( ) ) ? it->second : -1;
+    }
+    // Returns the index of a uniform block from its hashed name, GL_INVALID_INDEX if the program has no such block
+    GLuint GetUniformBlockIndex( GLuint nameHash ) const
+    {
+        std::unordered_map<GLuint, GLuint>::const_iterator it = this->blocks.find( nameHash );
+        return ( it != this->blocks.end( ) ) ? it->second : GL_INVALID_INDEX;
+    }
+    // Attaches a uniform block to a uniform buffer binding point
+    void BindUniformBlock( GLuint nameHash, GLuint bindingPoint )
+    {
+        GLuint blockIndex = this->GetUniformBlockIndex( nameHash );
+        if ( GL_INVALID_INDEX != blockIndex )
+        {
+            glUniformBlockBinding( this->Program, blockIndex, bindingPoint );
+        }
+    }
+    // Typed setters, they expect the shader to be in use. A value equal to the one last set is not sent again
+    void SetInt( GLuint nameHash, GLint value )
+    {
+        GLint location = this->GetUniformLocation( nameHash );
+        if ( this->changed( location, &value, sizeof( value ) ) )
+        {
+            glUniform1i( location, value );
+        }
+    }
+    void SetFloat( GLuint nameHash, GLfloat value )
+    {
+        GLint location = this->GetUniformLocation( nameHash );
+        if ( this->changed( location, &value, sizeof( value ) ) )
+        {
+            glUniform1f( location, value );
+        }
+    }
+    void SetVec2( GLuint nameHash, const glm::vec2 &value )
+    {
+        GLint location = this->GetUniformLocation( nameHash );
+        if ( this->changed( location, &value, sizeof( value ) ) )
+        {
+            glUniform2f( location, value.x, value.y );
+        }
+    }
+    void SetVec3( GLuint nameHash, const glm::vec3 &value )
+    {
+        GLint location = this->GetUniformLocation( nameHash );
+        if ( this->changed( location, &value, sizeof( value ) ) )
+        {
+            glUniform3f( location, value.x, value.y, value.z );
+        }
+    }
+    void SetVec4( GLuint nameHash, const glm::vec4 &value )
+    {
+        GLint location = this->GetUniformLocation( nameHash );
+        if ( this->changed( location, &value, sizeof( value ) ) )
+        {
+            glUniform4f( location, value.x, value.y, value.z, value.w );
+        }
+    }
+    void SetMat4( GLuint nameHash, const glm::mat4 &value )
+    {
+        GLint location = this->GetUniformLocation( nameHash );
+        if ( this->changed( location, glm::value_ptr( value ), sizeof( value ) ) )
+        {
+            glUniformMatrix4fv( location, 1, GL_FALSE, glm::value_ptr( value ) );
+        }
+    }
+    
+private:
+    // Last value sent to a location, as raw bytes so every uniform type fits
+    struct UniformValue
+    {
+        size_t size;
+        GLubyte data[sizeof( glm::mat4 )];
+        
+        UniformValue( ) : size( 0 )
+        {
+        }
+    };
+    
+    // Hashed name -> location of every active uniform in the default block
+    std::unordered_map<GLuint, GLint> uniforms;
+    // Hashed name -> index of every active uniform block
+    std::unordered_map<GLuint, GLuint> blocks;
+    // Location -> value it was last set to
+    std::unordered_map<GLint, UniformValue> values;
+    
+    // Compares a value with the one last set at a location and remembers it, returns false when the upload can be dropped
+    bool changed( GLint location, const void *value, size_t size )
+    {
+        // Like glUniform* we silently ignore uniforms the program doesn't have
+        if ( -1 == location )
+        {
+            return false;
+        }
+        
+        UniformValue &cached = this->values[location];
+        bool redundant = ( size == cached.size && 0 == std::memcmp( cached.data, value, size ) );
+        GLState::Get( ).RecordUniform( redundant );
+        if ( !redundant )
+        {
+            cached.size = size;
+            std::memcpy( cached.data, value, size );
+        }
+        return !redundant;
+    }
+    
+    // Stores a name in one of the tables, two names with the same hash would silently alias so they are reported
+    template <typename T>
+    void addName( std::unordered_map<GLuint, T> &table, const std::string &name, T value )
+    {
+        if ( !table.insert( std::make_pair( UniformHash( name.c_str( ) ), value ) ).second )
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION\n" << name << std::endl;
+        }
+    }
+    
+    // Builds the uniform and block tables with glGetActiveUniform/glGetActiveUniformBlockName
+    void reflect( )
+    {
+        GLint count, maxLength;
+        
+        // Uniforms in the default block
+        glGetProgramiv( this->Program, GL_ACTIVE_UNIFORMS, &count );
+        glGetProgramiv( this->Program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength );
+        std::vector<GLchar> nameBuffer( maxLength + 1 );
+        for ( GLint i = 0; i < count; i++ )
+        {
+            GLsizei length;
+            GLint size;
+            GLenum type;
+            glGetActiveUniform( this->Program, ( GLuint )i, ( GLsizei )nameBuffer.size( ), &length, &size, &type, nameBuffer.data( ) );
+            std::string name( nameBuffer.data( ), length );
+            GLint location = glGetUniformLocation( this->Program, name.c_str( ) );
+            // Members of uniform blocks have no location, they are reached through the block
+            if ( -1 == location )
+            {
+                continue;
+            }
+            // Arrays are reported as 'name[0]', register the bare name and every element as well
+            std::string::size_type bracket = name.rfind( "[0]" );
+            if ( std::string::npos != bracket && bracket + 3 == name.size( ) )
+            {
+                std::string base = name.substr( 0, bracket );
+                this->addName( this->uniforms, base, location );
+                for ( GLint element = 1; element < size; element++ )
+                {
+                    std::string elementName = base + "[" + std::to_string( element ) + "]";
+                    this->addName( this->uniforms, elementName, glGetUniformLocation( this->Program, elementName.c_str( ) ) );
+                }
+            }
+            this->addName( this->uniforms, name, location );
+        }
+        
+        // Uniform blocks
+        glGetProgramiv( this->Program, GL_ACTIVE_UNIFORM_BLOCKS, &count );
+        glGetProgramiv( this->Program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength );
+        nameBuffer.resize( maxLength + 1 );
+        for ( GLint i = 0; i < count; i++ )
+        {
+            GLsizei length;
+            glGetActiveUniformBlockName( this->Program, ( GLuint )i, ( GLsizei )nameBuffer.size( ), &length, nameBuffer.data( ) );
+            this->addName( this->blocks, std::string( nameBuffer.data( ), length ), ( GLuint )i );
+        }
     }
 };
 
@@ -0,0 +1,395 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#if defined( __AVX__ )
+#include <immintrin.h>
+#elif defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Transforms.h"
+#include "JobSystem.h"
+
+// Occlusion culling without the GPU. Every frame the occluders (the staircase) are rasterized on the CPU into a small depth
+// buffer, which is reduced into a pyramid where every texel holds the farthest depth of the four below it. A box is hidden
+// when its nearest point is behind the farthest depth of the few pyramid texels covering it, which is decided before any GL
+// call is made and without waiting on anything, the same with every driver.
+// The buffer is split in horizontal bands that are cleared and rasterized as jobs of the job system; spans of a row are
+// filled 8 pixels at a time with AVX, 4 with SSE, one at a time without either.
+class SoftwareOcclusion
+{
+public:
+    static const GLuint WIDTH = 256;
+    static const GLuint HEIGHT = 128;
+
+    SoftwareOcclusion( ) : tested( 0 ), culled( 0 ), renderTime( 0.0 )
+    {
+        for ( GLuint level = 0; level < LEVELS; level++ )
+        {
+            this->levels[level].resize( levelWidth( level ) * levelHeight( level ), 1.0f );
+        }
+    }
+
+    // Sets the occluders, world space triangles given by 3 consecutive vertices each
+    void SetOccluders( const std::vector<glm::vec3> &triangles )
+    {
+        this->occluders = triangles;
+    }
+
+    // Rasterizes the occluders as seen through 'viewProjection' and rebuilds the pyramid, call once per frame before Cull.
+    // The bands are rasterized by 'jobs'.
+    void Render( JobSystem &jobs, const glm::mat4 &viewProjection )
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+        this->viewProjection = viewProjection;
+        this->tested = 0;
+        this->culled = 0;
+
+        // Triangle setup is cheap next to filling them, it stays on this thread
+        this->triangles.clear( );
+        for ( size_t i = 0; i + 2 < this->occluders.size( ); i += 3 )
+        {
+            glm::vec4 clip[3];
+            for ( GLuint v = 0; v < 3; v++ )
+            {
+                clip[v] = viewProjection * glm::vec4( this->occluders[i + v], 1.0f );
+            }
+            this->clipNear( clip );
+        }
+
+        // A band is a job, bands write disjoint rows of the buffer and of level 1
+        jobs.ParallelFor( BANDS, 1, [this]( size_t first, size_t last )
+        {
+            for ( size_t band = first; band < last; band++ )
+            {
+                this->rasterizeBand( ( GLuint )band );
+            }
+        } );
+
+        // Level 1 was reduced by the bands, the remaining levels are tiny
+        for ( GLuint level = 2; level < LEVELS; level++ )
+        {
+            this->reduce( level, 0, levelHeight( level ) );
+        }
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now( ) - start;
+        this->renderTime = elapsed.count( );
+    }
+
+    // True unless the box is certainly behind the occluders of the last Render
+    bool IsVisible( glm::vec3 min, glm::vec3 max ) const
+    {
+        GLfloat x0 = FLT_MAX, y0 = FLT_MAX, x1 = -FLT_MAX, y1 = -FLT_MAX, nearest = FLT_MAX;
+        for ( GLuint corner = 0; corner < 8; corner++ )
+        {
+            glm::vec3 point( ( corner & 1 ) ? max.x : min.x, ( corner & 2 ) ? max.y : min.y, ( corner & 4 ) ? max.z : min.z );
+            glm::vec4 clip = this->viewProjection * glm::vec4( point, 1.0f );
+            // Reaches behind the camera, the projection of the box says nothing
+            if ( clip.w <= MIN_W )
+            {
+                return true;
+            }
+
+            GLfloat x = ( clip.x / clip.w * 0.5f + 0.5f ) * WIDTH;
+            GLfloat y = ( clip.y / clip.w * 0.5f + 0.5f ) * HEIGHT;
+            x0 = std::min( x0, x );
+            x1 = std::max( x1, x );
+            y0 = std::min( y0, y );
+            y1 = std::max( y1, y );
+            nearest = std::min( nearest, clip.z / clip.w );
+        }
+
+        GLint left = std::max( ( GLint )std::floor( x0 ), 0 ), right = std::min( ( GLint )std::floor( x1 ), ( GLint )WIDTH - 1 );
+        GLint bottom = std::max( ( GLint )std::floor( y0 ), 0 ), top = std::min( ( GLint )std::floor( y1 ), ( GLint )HEIGHT - 1 );
+        if ( left > right || bottom > top )
+        {
+            return true;
+        }
+
+        // The level where the rectangle spans at most 3x3 texels
+        GLuint span = ( GLuint )std::max( right - left, top - bottom ) + 1;
+        GLuint level = 0;
+        while ( ( span >> level ) > 2 && level + 1 < LEVELS )
+        {
+            level++;
+        }
+
+        GLfloat farthest = 0.0f;
+        const std::vector<GLfloat> &depth = this->levels[level];
+        for ( GLint y = bottom >> level; y <= ( top >> level ); y++ )
+        {
+            for ( GLint x = left >> level; x <= ( right >> level ); x++ )
+            {
+                farthest = std::max( farthest, depth[y * levelWidth( level ) + x] );
+            }
+        }
+        return nearest <= farthest;
+    }
+
+    // Removes the hidden objects from 'visible', instances of the unit cube scaled by 'size'
+    void Cull( std::vector<GLuint> &visible, const TransformSystem &transforms, GLfloat size )
+    {
+        glm::vec3 halfSize( 0.5f * size );
+        size_t kept = 0;
+        for ( size_t i = 0; i < visible.size( ); i++ )
+        {
+            glm::vec3 position = transforms.GetPosition( visible[i] );
+            if ( this->IsVisible( position - halfSize, position + halfSize ) )
+            {
+                visible[kept++] = visible[i];
+            }
+        }
+        this->tested += ( GLuint )visible.size( );
+        this->culled += ( GLuint )( visible.size( ) - kept );
+        visible.resize( kept );
+    }
+
+    // Objects passed to Cull since the last Render
+    GLuint GetTested( ) const
+    {
+        return this->tested;
+    }
+
+    // Of those, the ones that were removed
+    GLuint GetCulled( ) const
+    {
+        return this->culled;
+    }
+
+    // Milliseconds the last Render took, rasterization and pyramid
+    double GetRenderTime( ) const
+    {
+        return this->renderTime;
+    }
+
+private:
+    // Horizontal bands the buffer is split into, each one is rasterized by one job
+    static const GLuint BANDS = 8;
+    static const GLuint BAND_HEIGHT = HEIGHT / BANDS;
+    // 256x128 down to 1x1
+    static const GLuint LEVELS = 9;
+    static constexpr GLfloat MIN_W = 1.0e-5f;
+
+#if defined( __AVX__ )
+    static const GLuint LANES = 8;
+#elif defined( __SSE2__ )
+    static const GLuint LANES = 4;
+#else
+    static const GLuint LANES = 1;
+#endif
+
+    // Edge functions and depth plane of a triangle in pixel coordinates, E(x, y) = A x + B y + C is >= 0 inside every edge
+    struct RasterTriangle
+    {
+        GLfloat edgeA[3], edgeB[3], edgeC[3];
+        GLfloat depthA, depthB, depthC;
+        GLint minX, maxX, minY, maxY;
+    };
+
+    std::vector<glm::vec3> occluders;
+    std::vector<RasterTriangle> triangles;
+    glm::mat4 viewProjection;
+    // Level 0 is the depth buffer, NDC depth with 1 on the far plane
+    std::vector<GLfloat> levels[LEVELS];
+
+    GLuint tested;
+    GLuint culled;
+    double renderTime;
+
+    static GLuint levelWidth( GLuint level )
+    {
+        return std::max( WIDTH >> level, 1u );
+    }
+
+    static GLuint levelHeight( GLuint level )
+    {
+        return std::max( HEIGHT >> level, 1u );
+    }
+
+    // Clears a band, draws every triangle into it and reduces it into its rows of level 1
+    void rasterizeBand( GLuint band )
+    {
+        GLint bandTop = ( GLint )( band * BAND_HEIGHT ), bandBottom = bandTop + ( GLint )BAND_HEIGHT - 1;
+        std::vector<GLfloat> &depth = this->levels[0];
+        std::fill( depth.begin( ) + bandTop * WIDTH, depth.begin( ) + ( bandBottom + 1 ) * WIDTH, 1.0f );
+
+        for ( size_t t = 0; t < this->triangles.size( ); t++ )
+        {
+            const RasterTriangle &triangle = this->triangles[t];
+            GLint first = std::max( triangle.minY, bandTop ), last = std::min( triangle.maxY, bandBottom );
+            // Start on a multiple of the lane count, the buffer width is one so a group never leaves the row
+            GLint left = triangle.minX & ~( GLint )( LANES - 1 );
+            for ( GLint y = first; y <= last; y++ )
+            {
+                this->fillSpan( triangle, &depth[y * WIDTH], left, triangle.maxX, y + 0.5f );
+            }
+        }
+
+        this->reduce( 1, band * BAND_HEIGHT / 2, ( band + 1 ) * BAND_HEIGHT / 2 );
+    }
+
+    // Writes the triangle's depth into the pixels from 'left' to 'right' of a row that are inside it and nearer
+    void fillSpan( const RasterTriangle &triangle, GLfloat *row, GLint left, GLint right, GLfloat centerY ) const
+    {
+        GLfloat rowEdge[3];
+        for ( GLuint e = 0; e < 3; e++ )
+        {
+            rowEdge[e] = triangle.edgeB[e] * centerY + triangle.edgeC[e];
+        }
+        GLfloat rowDepth = triangle.depthB * centerY + triangle.depthC;
+
+#if defined( __AVX__ )
+        const __m256 offsets = _mm256_setr_ps( 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f );
+        for ( GLint x = left; x <= right; x += 8 )
+        {
+            __m256 centerX = _mm256_add_ps( _mm256_set1_ps( ( GLfloat )x ), offsets );
+            __m256 inside = _mm256_cmp_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( triangle.edgeA[0] ), centerX ), _mm256_set1_ps( rowEdge[0] ) ), _mm256_setzero_ps( ), _CMP_GE_OQ );
+            inside = _mm256_and_ps( inside, _mm256_cmp_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( triangle.edgeA[1] ), centerX ), _mm256_set1_ps( rowEdge[1] ) ), _mm256_setzero_ps( ), _CMP_GE_OQ ) );
+            inside = _mm256_and_ps( inside, _mm256_cmp_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( triangle.edgeA[2] ), centerX ), _mm256_set1_ps( rowEdge[2] ) ), _mm256_setzero_ps( ), _CMP_GE_OQ ) );
+            if ( 0 == _mm256_movemask_ps( inside ) )
+            {
+                continue;
+            }
+
+            __m256 z = _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( triangle.depthA ), centerX ), _mm256_set1_ps( rowDepth ) );
+            __m256 stored = _mm256_loadu_ps( row + x );
+            _mm256_storeu_ps( row + x, _mm256_blendv_ps( stored, _mm256_min_ps( stored, z ), inside ) );
+        }
+#elif defined( __SSE2__ )
+        const __m128 offsets = _mm_setr_ps( 0.5f, 1.5f, 2.5f, 3.5f );
+        for ( GLint x = left; x <= right; x += 4 )
+        {
+            __m128 centerX = _mm_add_ps( _mm_set1_ps( ( GLfloat )x ), offsets );
+            __m128 inside = _mm_cmpge_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( triangle.edgeA[0] ), centerX ), _mm_set1_ps( rowEdge[0] ) ), _mm_setzero_ps( ) );
+            inside = _mm_and_ps( inside, _mm_cmpge_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( triangle.edgeA[1] ), centerX ), _mm_set1_ps( rowEdge[1] ) ), _mm_setzero_ps( ) ) );
+            inside = _mm_and_ps( inside, _mm_cmpge_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( triangle.edgeA[2] ), centerX ), _mm_set1_ps( rowEdge[2] ) ), _mm_setzero_ps( ) ) );
+            if ( 0 == _mm_movemask_ps( inside ) )
+            {
+                continue;
+            }
+
+            __m128 z = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( triangle.depthA ), centerX ), _mm_set1_ps( rowDepth ) );
+            __m128 stored = _mm_loadu_ps( row + x );
+            __m128 nearer = _mm_min_ps( stored, z );
+            _mm_storeu_ps( row + x, _mm_or_ps( _mm_and_ps( inside, nearer ), _mm_andnot_ps( inside, stored ) ) );
+        }
+#else
+        for ( GLint x = left; x <= right; x++ )
+        {
+            GLfloat centerX = x + 0.5f;
+            if ( triangle.edgeA[0] * centerX + rowEdge[0] >= 0.0f && triangle.edgeA[1] * centerX + rowEdge[1] >= 0.0f && triangle.edgeA[2] * centerX + rowEdge[2] >= 0.0f )
+            {
+                row[x] = std::min( row[x], triangle.depthA * centerX + rowDepth );
+            }
+        }
+#endif
+    }
+
+    // Fills rows [first, last) of a pyramid level with the farthest depth of the 2x2 texels below each texel
+    void reduce( GLuint level, GLuint first, GLuint last )
+    {
+        const std::vector<GLfloat> &below = this->levels[level - 1];
+        std::vector<GLfloat> &above = this->levels[level];
+        GLuint belowWidth = levelWidth( level - 1 ), belowHeight = levelHeight( level - 1 );
+        for ( GLuint y = first; y < last; y++ )
+        {
+            GLuint y0 = std::min( 2 * y, belowHeight - 1 ), y1 = std::min( 2 * y + 1, belowHeight - 1 );
+            for ( GLuint x = 0; x < levelWidth( level ); x++ )
+            {
+                GLuint x0 = std::min( 2 * x, belowWidth - 1 ), x1 = std::min( 2 * x + 1, belowWidth - 1 );
+                above[y * levelWidth( level ) + x] = std::max( std::max( below[y0 * belowWidth + x0], below[y0 * belowWidth + x1] ),
+                                                               std::max( below[y1 * belowWidth + x0], below[y1 * belowWidth + x1] ) );
+            }
+        }
+    }
+
+    // Clips a clip space triangle against the near plane (z >= -w) and sets up what is left of it
+    void clipNear( const glm::vec4 *clip )
+    {
+        glm::vec4 polygon[4];
+        GLuint count = 0;
+        for ( GLuint i = 0; i < 3; i++ )
+        {
+            const glm::vec4 &a = clip[i], &b = clip[( i + 1 ) % 3];
+            GLfloat da = a.z + a.w, db = b.z + b.w;
+            if ( da >= 0.0f )
+            {
+                polygon[count++] = a;
+            }
+            if ( ( da >= 0.0f ) != ( db >= 0.0f ) )
+            {
+                polygon[count++] = a + ( b - a ) * ( da / ( da - db ) );
+            }
+        }
+
+        for ( GLuint i = 1; i + 1 < count; i++ )
+        {
+            this->setup( polygon[0], polygon[i], polygon[i + 1] );
+        }
+    }
+
+    void setup( glm::vec4 a, glm::vec4 b, glm::vec4 c )
+    {
+        // Pixel coordinates and NDC depth
+        glm::vec3 v[3];
+        const glm::vec4 *clip[3] = { &a, &b, &c };
+        for ( GLuint i = 0; i < 3; i++ )
+        {
+            GLfloat w = ( clip[i]->w > MIN_W ) ? clip[i]->w : MIN_W;
+            v[i] = glm::vec3( ( clip[i]->x / w * 0.5f + 0.5f ) * WIDTH, ( clip[i]->y / w * 0.5f + 0.5f ) * HEIGHT, clip[i]->z / w );
+        }
+
+        // Occluders are two sided, a clockwise triangle is turned around
+        GLfloat area = ( v[1].x - v[0].x ) * ( v[2].y - v[0].y ) - ( v[2].x - v[0].x ) * ( v[1].y - v[0].y );
+        if ( area < 0.0f )
+        {
+            std::swap( v[1], v[2] );
+            area = -area;
+        }
+        if ( area < 1.0e-6f )
+        {
+            return;
+        }
+
+        RasterTriangle triangle;
+        GLfloat minX = std::min( std::min( v[0].x, v[1].x ), v[2].x ), maxX = std::max( std::max( v[0].x, v[1].x ), v[2].x );
+        GLfloat minY = std::min( std::min( v[0].y, v[1].y ), v[2].y ), maxY = std::max( std::max( v[0].y, v[1].y ), v[2].y );
+        triangle.minX = ( GLint )std::max( minX, 0.0f );
+        triangle.maxX = ( GLint )std::min( maxX, ( GLfloat )WIDTH - 1.0f );
+        triangle.minY = ( GLint )std::max( minY, 0.0f );
+        triangle.maxY = ( GLint )std::min( maxY, ( GLfloat )HEIGHT - 1.0f );
+        if ( triangle.minX > triangle.maxX || triangle.minY > triangle.maxY || maxX < 0.0f || maxY < 0.0f )
+        {
+            return;
+        }
+
+        // Edge i runs from vertex i to the next one. Divided by the area it is the barycentric weight of the vertex opposite to
+        // it, so the same coefficients interpolate the depth
+        triangle.depthA = triangle.depthB = triangle.depthC = 0.0f;
+        for ( GLuint i = 0; i < 3; i++ )
+        {
+            const glm::vec3 &from = v[i], &to = v[( i + 1 ) % 3];
+            triangle.edgeA[i] = from.y - to.y;
+            triangle.edgeB[i] = to.x - from.x;
+            triangle.edgeC[i] = from.x * to.y - from.y * to.x;
+
+            GLfloat weight = v[( i + 2 ) % 3].z / area;
+            triangle.depthA += triangle.edgeA[i] * weight;
+            triangle.depthB += triangle.edgeB[i] * weight;
+            triangle.depthC += triangle.edgeC[i] * weight;
+        }
+        this->triangles.push_back( triangle );
+    }
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <algorithm>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Indexed mesh of the scene: a floor, a straight flight of stairs climbing along -z from the origin, and a wall on both sides
+// of the flight. Every quad is flat shaded, so it has four vertices of its own and six indices; neighbouring quads share
+// positions but never normals, which leaves nothing else to merge. Vertices are position, normal and texture coordinates,
+// the layout of the VAO attributes 0, 1 and 2.
+class Staircase
+{
+public:
+    // Floats per vertex and indices per quad
+    static const GLuint VERTEX_FLOATS = 8;
+    static const GLuint QUAD_INDICES = 6;
+
+    Staircase( ) : steps( 0 ), rise( 0.0f ), run( 0.0f ), width( 0.0f )
+    {
+    }
+
+    // Generates a flight of 'steps' steps, each 'rise' higher and 'run' deeper than the one before and 'width' wide. The
+    // bottom step is a tread on the floor, so there is one more tread than risers.
+    void Generate( GLuint steps, GLfloat rise, GLfloat run, GLfloat width )
+    {
+        this->steps = steps;
+        this->rise = rise;
+        this->run = run;
+        this->width = width;
+        this->vertices.clear( );
+        this->indices.clear( );
+
+        // The floor reaches past the end of the flight whatever its length
+        GLfloat length = this->GetLength( );
+        GLfloat floorSize = ( length + FLOOR_MARGIN > FLOOR_HALF_SIZE ) ? length + FLOOR_MARGIN : FLOOR_HALF_SIZE;
+        this->addQuad( glm::vec3( -floorSize, 0.0f, floorSize ), glm::vec3( 2.0f * floorSize, 0.0f, 0.0f ), glm::vec3( 0.0f, 0.0f, -2.0f * floorSize ), glm::vec3( 0.0f, 1.0f, 0.0f ) );
+
+        // Walls from the first riser to one run past the top tread, with headroom over the top of the flight
+        GLfloat halfWidth = 0.5f * width;
+        GLfloat height = steps * rise + WALL_HEADROOM;
+        this->addQuad( glm::vec3( -halfWidth, 0.0f, -run ), glm::vec3( 0.0f, 0.0f, run - length ), glm::vec3( 0.0f, height, 0.0f ), glm::vec3( 1.0f, 0.0f, 0.0f ) );
+        this->addQuad( glm::vec3( halfWidth, 0.0f, -length ), glm::vec3( 0.0f, 0.0f, length - run ), glm::vec3( 0.0f, height, 0.0f ), glm::vec3( -1.0f, 0.0f, 0.0f ) );
+
+        // Tread of step i, then the riser up to step i + 1
+        glm::vec3 across( width, 0.0f, 0.0f );
+        for ( GLuint i = 0; i <= steps; i++ )
+        {
+            GLfloat y = i * rise, z = -( i * run );
+            this->addQuad( glm::vec3( -halfWidth, y, z ), across, glm::vec3( 0.0f, 0.0f, -run ), glm::vec3( 0.0f, 1.0f, 0.0f ) );
+            if ( i < steps )
+            {
+                this->addQuad( glm::vec3( -halfWidth, y, z - run ), across, glm::vec3( 0.0f, rise, 0.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) );
+            }
+        }
+    }
+
+    // Positions of 'pairs' pairs of lamps spread evenly along the walls, just inside them and a fixed height over the slope
+    // of the flight. Mesh space, like the vertices.
+    std::vector<glm::vec3> GetLampPositions( GLuint pairs ) const
+    {
+        std::vector<glm::vec3> positions;
+        GLfloat x = 0.5f * this->width - LAMP_INSET;
+        for ( GLuint side = 0; side < 2; side++ )
+        {
+            // Top of the flight first
+            for ( GLuint i = pairs; i > 0; i-- )
+            {
+                GLfloat depth = this->GetLength( ) * i / ( pairs + 1 );
+                GLfloat y = std::min( depth / this->run, ( GLfloat )this->steps ) * this->rise + LAMP_HEIGHT;
+                positions.push_back( glm::vec3( ( 0 == side ) ? -x : x, y, -depth ) );
+            }
+        }
+        return positions;
+    }
+
+    // Middle of the tread of step 'step', the bottom one on the floor being step 0. Mesh space, like the vertices.
+    glm::vec3 GetTreadCenter( GLuint step ) const
+    {
+        return glm::vec3( 0.0f, step * this->rise, -( step + 0.5f ) * this->run );
+    }
+
+    // Depth of the flight from its bottom step to the end of the walls
+    GLfloat GetLength( ) const
+    {
+        return ( this->steps + 2 ) * this->run;
+    }
+
+    const std::vector<GLfloat> &GetVertices( ) const
+    {
+        return this->vertices;
+    }
+
+    const std::vector<GLuint> &GetIndices( ) const
+    {
+        return this->indices;
+    }
+
+    GLuint GetQuadCount( ) const
+    {
+        return ( GLuint )this->indices.size( ) / QUAD_INDICES;
+    }
+
+    // Position of the vertex at 'index' of the index buffer
+    glm::vec3 GetPosition( GLuint index ) const
+    {
+        const GLfloat *vertex = &this->vertices[this->indices[index] * VERTEX_FLOATS];
+        return glm::vec3( vertex[0], vertex[1], vertex[2] );
+    }
+
+private:
+    // Half the side of the floor under short flights
+    static constexpr GLfloat FLOOR_HALF_SIZE = 100.0f;
+    // Floor left around long flights
+    static constexpr GLfloat FLOOR_MARGIN = 10.0f;
+    // Height of the walls over the top tread
+    static constexpr GLfloat WALL_HEADROOM = 2.6f;
+    // Lamps hang this far inside the walls and this high over the slope of the flight
+    static constexpr GLfloat LAMP_INSET = 0.1f;
+    static constexpr GLfloat LAMP_HEIGHT = 1.2f;
+
+    GLuint steps;
+    GLfloat rise;
+    GLfloat run;
+    GLfloat width;
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+
+    // Quad spanned by the edges 'u' and 'v' from 'origin', facing the side that sees it counter-clockwise. Texture coordinates
+    // run from 0 to 1 along both edges.
+    void addQuad( glm::vec3 origin, glm::vec3 u, glm::vec3 v, glm::vec3 normal )
+    {
+        GLuint first = ( GLuint )( this->vertices.size( ) / VERTEX_FLOATS );
+        const glm::vec2 corners[4] = { glm::vec2( 0.0f, 0.0f ), glm::vec2( 1.0f, 0.0f ), glm::vec2( 1.0f, 1.0f ), glm::vec2( 0.0f, 1.0f ) };
+        for ( GLuint i = 0; i < 4; i++ )
+        {
+            glm::vec3 position = origin + corners[i].x * u + corners[i].y * v;
+            const GLfloat vertex[VERTEX_FLOATS] = { position.x, position.y, position.z, normal.x, normal.y, normal.z, corners[i].x, corners[i].y };
+            this->vertices.insert( this->vertices.end( ), vertex, vertex + VERTEX_FLOATS );
+        }
+
+        const GLuint quad[QUAD_INDICES] = { 0, 1, 2, 2, 3, 0 };
+        for ( GLuint i = 0; i < QUAD_INDICES; i++ )
+        {
+            this->indices.push_back( first + quad[i] );
+        }
+    }
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Geometry that never moves, merged at load time into one vertex and index buffer per material. Every mesh added is
+// transformed into world space on the way in, so the whole batch is drawn with the identity transform in one call:
+// instanced draws of copies and per object uniforms are gone, and culling only has to pick which index ranges to draw.
+// Vertices are 'vertexFloats' floats with the position first and, when there are normals, the normal right after it.
+class StaticBatch
+{
+public:
+    StaticBatch( GLuint vertexFloats, bool normals ) : vertexFloats( vertexFloats ), normals( normals )
+    {
+    }
+
+    // Adds an indexed mesh placed by 'model' and returns its object number, objects are numbered in the order they are added
+    GLuint Add( const std::vector<GLfloat> &vertices, const std::vector<GLuint> &indices, const glm::mat4 &model )
+    {
+        GLuint base = this->GetVertexCount( );
+        glm::mat3 normalMatrix = glm::transpose( glm::inverse( glm::mat3( model ) ) );
+        for ( size_t i = 0; i < vertices.size( ); i += this->vertexFloats )
+        {
+            size_t first = this->vertices.size( );
+            this->vertices.insert( this->vertices.end( ), &vertices[i], &vertices[i] + this->vertexFloats );
+
+            glm::vec3 position = glm::vec3( model * glm::vec4( vertices[i], vertices[i + 1], vertices[i + 2], 1.0f ) );
+            for ( GLuint axis = 0; axis < 3; axis++ )
+            {
+                this->vertices[first + axis] = position[axis];
+            }
+            if ( this->normals )
+            {
+                glm::vec3 normal = glm::normalize( normalMatrix * glm::vec3( vertices[i + 3], vertices[i + 4], vertices[i + 5] ) );
+                for ( GLuint axis = 0; axis < 3; axis++ )
+                {
+                    this->vertices[first + 3 + axis] = normal[axis];
+                }
+            }
+        }
+
+        this->firsts.push_back( ( GLuint )this->indices.size( ) );
+        this->counts.push_back( ( GLuint )indices.size( ) );
+        for ( size_t i = 0; i < indices.size( ); i++ )
+        {
+            this->indices.push_back( base + indices[i] );
+        }
+        return ( GLuint )this->firsts.size( ) - 1;
+    }
+
+    // Index ranges of the listed objects, sorted by object, for one glMultiDrawElements. Objects next to each other in the
+    // batch become one range.
+    void BuildDrawRanges( const std::vector<GLuint> &objects, std::vector<GLint> &firsts, std::vector<GLsizei> &counts ) const
+    {
+        firsts.clear( );
+        counts.clear( );
+        for ( size_t i = 0; i < objects.size( ); i++ )
+        {
+            GLint first = ( GLint )this->firsts[objects[i]];
+            GLsizei count = ( GLsizei )this->counts[objects[i]];
+            if ( !firsts.empty( ) && firsts.back( ) + counts.back( ) == first )
+            {
+                counts.back( ) += count;
+            }
+            else
+            {
+                firsts.push_back( first );
+                counts.push_back( count );
+            }
+        }
+    }
+
+    // First index and number of indices of an object
+    GLuint GetFirstIndex( GLuint object ) const
+    {
+        return this->firsts[object];
+    }
+
+    GLuint GetIndexCount( GLuint object ) const
+    {
+        return this->counts[object];
+    }
+
+    // World space position of the vertex at 'index' of the index buffer
+    glm::vec3 GetPosition( GLuint index ) const
+    {
+        const GLfloat *vertex = &this->vertices[this->indices[index] * this->vertexFloats];
+        return glm::vec3( vertex[0], vertex[1], vertex[2] );
+    }
+
+    const std::vector<GLfloat> &GetVertices( ) const
+    {
+        return this->vertices;
+    }
+
+    const std::vector<GLuint> &GetIndices( ) const
+    {
+        return this->indices;
+    }
+
+    GLuint GetVertexCount( ) const
+    {
+        return ( GLuint )( this->vertices.size( ) / this->vertexFloats );
+    }
+
+private:
+    GLuint vertexFloats;
+    bool normals;
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+    // Index range of every object
+    std::vector<GLuint> firsts;
+    std::vector<GLuint> counts;
+};
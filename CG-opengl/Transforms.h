@@ -0,0 +1,328 @@
+#pragma once
+
+// Std. Includes
+#include <cmath>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#if defined( __AVX__ )
+#include <immintrin.h>
+#elif defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Everything the vertex shader needs of one instance: the model matrix for the world space position,
+// the normal matrix already inverted and transposed and the full model-view-projection matrix.
+// The normal matrix columns are padded to vec4 so every member stays 16 byte aligned.
+struct InstanceTransform
+{
+    glm::mat4 model;
+    glm::vec4 normal[3];
+    glm::mat4 mvp;
+};
+
+static_assert( sizeof( InstanceTransform ) == 44 * sizeof( GLfloat ), "InstanceTransform must be tightly packed" );
+
+// One lane type per instruction set. Every one of them offers the same few operations, so the transform
+// kernel below is written once and runs on 8 objects at a time with AVX, 4 with SSE or one at a time without either.
+// The Xcode project doesn't pass -mavx, so this choice and the ones made the same way (CubeLanes, the span fill of
+// SoftwareOcclusion) come out SSE2 on x86 Macs and scalar on Apple Silicon. BoxCuller picks AVX at runtime instead.
+#if defined( __AVX__ )
+struct TransformLanes
+{
+    typedef __m256 Type;
+    static const size_t WIDTH = 8;
+
+    static Type Load( const GLfloat *p ) { return _mm256_loadu_ps( p ); }
+    static Type Set( GLfloat v ) { return _mm256_set1_ps( v ); }
+    static Type Add( Type a, Type b ) { return _mm256_add_ps( a, b ); }
+    static Type Sub( Type a, Type b ) { return _mm256_sub_ps( a, b ); }
+    static Type Mul( Type a, Type b ) { return _mm256_mul_ps( a, b ); }
+    static Type Div( Type a, Type b ) { return _mm256_div_ps( a, b ); }
+
+    // Writes one vec4 per object, 'offset' floats into each InstanceTransform. Both halves go through a 4x4 transpose.
+    static void Store( InstanceTransform *out, size_t offset, Type x, Type y, Type z, Type w )
+    {
+        store4( out, offset, _mm256_castps256_ps128( x ), _mm256_castps256_ps128( y ), _mm256_castps256_ps128( z ), _mm256_castps256_ps128( w ) );
+        store4( out + 4, offset, _mm256_extractf128_ps( x, 1 ), _mm256_extractf128_ps( y, 1 ), _mm256_extractf128_ps( z, 1 ), _mm256_extractf128_ps( w, 1 ) );
+    }
+
+private:
+    static void store4( InstanceTransform *out, size_t offset, __m128 x, __m128 y, __m128 z, __m128 w )
+    {
+        _MM_TRANSPOSE4_PS( x, y, z, w );
+        _mm_storeu_ps( ( GLfloat * )&out[0] + offset, x );
+        _mm_storeu_ps( ( GLfloat * )&out[1] + offset, y );
+        _mm_storeu_ps( ( GLfloat * )&out[2] + offset, z );
+        _mm_storeu_ps( ( GLfloat * )&out[3] + offset, w );
+    }
+};
+#elif defined( __SSE2__ )
+struct TransformLanes
+{
+    typedef __m128 Type;
+    static const size_t WIDTH = 4;
+
+    static Type Load( const GLfloat *p ) { return _mm_loadu_ps( p ); }
+    static Type Set( GLfloat v ) { return _mm_set1_ps( v ); }
+    static Type Add( Type a, Type b ) { return _mm_add_ps( a, b ); }
+    static Type Sub( Type a, Type b ) { return _mm_sub_ps( a, b ); }
+    static Type Mul( Type a, Type b ) { return _mm_mul_ps( a, b ); }
+    static Type Div( Type a, Type b ) { return _mm_div_ps( a, b ); }
+
+    // Writes one vec4 per object, 'offset' floats into each InstanceTransform
+    static void Store( InstanceTransform *out, size_t offset, Type x, Type y, Type z, Type w )
+    {
+        _MM_TRANSPOSE4_PS( x, y, z, w );
+        _mm_storeu_ps( ( GLfloat * )&out[0] + offset, x );
+        _mm_storeu_ps( ( GLfloat * )&out[1] + offset, y );
+        _mm_storeu_ps( ( GLfloat * )&out[2] + offset, z );
+        _mm_storeu_ps( ( GLfloat * )&out[3] + offset, w );
+    }
+};
+#else
+struct TransformLanes
+{
+    typedef GLfloat Type;
+    static const size_t WIDTH = 1;
+
+    static Type Load( const GLfloat *p ) { return *p; }
+    static Type Set( GLfloat v ) { return v; }
+    static Type Add( Type a, Type b ) { return a + b; }
+    static Type Sub( Type a, Type b ) { return a - b; }
+    static Type Mul( Type a, Type b ) { return a * b; }
+    static Type Div( Type a, Type b ) { return a / b; }
+
+    static void Store( InstanceTransform *out, size_t offset, Type x, Type y, Type z, Type w )
+    {
+        GLfloat *p = ( GLfloat * )out + offset;
+        p[0] = x;
+        p[1] = y;
+        p[2] = z;
+        p[3] = w;
+    }
+};
+#endif
+
+// Positions, scales and rotations of a group of objects sharing one mesh, kept as separate arrays (structure of arrays)
+// so their matrices can be built several objects per instruction. Model = translate * rotate * scale, which means
+// the normal matrix is just rotate * scale^-1 and no object ever needs a general 4x4 inverse.
+class TransformSystem
+{
+public:
+    TransformSystem( ) : count( 0 ), hasMeshTransform( false )
+    {
+    }
+
+    // Removes every object
+    void Clear( )
+    {
+        this->count = 0;
+        this->resize( 0 );
+    }
+
+    // Adds an object and returns its index. The rotation is 'angle' radians around 'axis'.
+    GLuint Add( glm::vec3 position, glm::vec3 scale = glm::vec3( 1.0f ), GLfloat angle = 0.0f, glm::vec3 axis = glm::vec3( 0.0f, 1.0f, 0.0f ) )
+    {
+        GLuint index = this->count++;
+        this->resize( this->count );
+        this->SetPosition( index, position );
+        this->SetScale( index, scale );
+        this->SetRotation( index, angle, axis );
+        return index;
+    }
+
+    // Keeps the first 'count' objects, new ones start at the origin with no rotation and unit scale
+    void Resize( GLuint count )
+    {
+        this->count = count;
+        this->resize( count );
+    }
+
+    void SetPosition( GLuint i, glm::vec3 position )
+    {
+        this->positionX[i] = position.x;
+        this->positionY[i] = position.y;
+        this->positionZ[i] = position.z;
+    }
+
+    void SetScale( GLuint i, glm::vec3 scale )
+    {
+        this->scaleX[i] = scale.x;
+        this->scaleY[i] = scale.y;
+        this->scaleZ[i] = scale.z;
+    }
+
+    // Stored as a unit quaternion
+    void SetRotation( GLuint i, GLfloat angle, glm::vec3 axis )
+    {
+        glm::vec3 unitAxis = glm::normalize( axis ) * std::sin( angle * 0.5f );
+        this->rotationX[i] = unitAxis.x;
+        this->rotationY[i] = unitAxis.y;
+        this->rotationZ[i] = unitAxis.z;
+        this->rotationW[i] = std::cos( angle * 0.5f );
+    }
+
+    // Transform from the vertices of the mesh every object draws to the mesh's own space, e.g. the decoding of packed
+    // positions (VertexPacking.h). It goes after the model and model-view-projection matrices; the normal matrix is left
+    // alone, as normals are packed on their own.
+    void SetMeshTransform( const glm::mat4 &meshTransform )
+    {
+        this->meshTransform = meshTransform;
+        this->hasMeshTransform = true;
+    }
+
+    // Builds model, normal and model-view-projection matrices of every object
+    void Update( const glm::mat4 &viewProjection )
+    {
+        this->Update( viewProjection, 0, this->count );
+    }
+
+    // Builds the matrices of the objects [first, last) only, 'first' a multiple of the lane width. Ranges that don't overlap
+    // can be built on threads of their own.
+    void Update( const glm::mat4 &viewProjection, size_t first, size_t last )
+    {
+        typedef TransformLanes L;
+
+        // Columns of the view-projection matrix, broadcast to all lanes
+        L::Type vp[4][4];
+        for ( GLuint column = 0; column < 4; column++ )
+        {
+            for ( GLuint row = 0; row < 4; row++ )
+            {
+                vp[column][row] = L::Set( viewProjection[column][row] );
+            }
+        }
+
+        const L::Type zero = L::Set( 0.0f );
+        const L::Type one = L::Set( 1.0f );
+        const L::Type two = L::Set( 2.0f );
+
+        // The arrays are padded to a whole number of lanes, the padding is harmless identity objects
+        for ( size_t i = first; i < last; i += L::WIDTH )
+        {
+            L::Type px = L::Load( &this->positionX[i] ), py = L::Load( &this->positionY[i] ), pz = L::Load( &this->positionZ[i] );
+            L::Type sx = L::Load( &this->scaleX[i] ), sy = L::Load( &this->scaleY[i] ), sz = L::Load( &this->scaleZ[i] );
+            L::Type qx = L::Load( &this->rotationX[i] ), qy = L::Load( &this->rotationY[i] ), qz = L::Load( &this->rotationZ[i] ), qw = L::Load( &this->rotationW[i] );
+
+            // Rotation matrix from the quaternion
+            L::Type xx = L::Mul( qx, qx ), yy = L::Mul( qy, qy ), zz = L::Mul( qz, qz );
+            L::Type xy = L::Mul( qx, qy ), xz = L::Mul( qx, qz ), yz = L::Mul( qy, qz );
+            L::Type wx = L::Mul( qw, qx ), wy = L::Mul( qw, qy ), wz = L::Mul( qw, qz );
+
+            L::Type r[3][3];
+            r[0][0] = L::Sub( one, L::Mul( two, L::Add( yy, zz ) ) );
+            r[0][1] = L::Mul( two, L::Add( xy, wz ) );
+            r[0][2] = L::Mul( two, L::Sub( xz, wy ) );
+            r[1][0] = L::Mul( two, L::Sub( xy, wz ) );
+            r[1][1] = L::Sub( one, L::Mul( two, L::Add( xx, zz ) ) );
+            r[1][2] = L::Mul( two, L::Add( yz, wx ) );
+            r[2][0] = L::Mul( two, L::Add( xz, wy ) );
+            r[2][1] = L::Mul( two, L::Sub( yz, wx ) );
+            r[2][2] = L::Sub( one, L::Mul( two, L::Add( xx, yy ) ) );
+
+            L::Type scale[3] = { sx, sy, sz };
+            L::Type m[4][3];
+            for ( GLuint column = 0; column < 3; column++ )
+            {
+                L::Type inverseScale = L::Div( one, scale[column] );
+                for ( GLuint row = 0; row < 3; row++ )
+                {
+                    m[column][row] = L::Mul( r[column][row], scale[column] );
+                    r[column][row] = L::Mul( r[column][row], inverseScale );
+                }
+            }
+            m[3][0] = px;
+            m[3][1] = py;
+            m[3][2] = pz;
+
+            InstanceTransform *out = &this->instances[i];
+            for ( GLuint column = 0; column < 4; column++ )
+            {
+                L::Type w = ( 3 == column ) ? one : zero;
+                L::Store( out, offsetof( InstanceTransform, model ) / sizeof( GLfloat ) + column * 4, m[column][0], m[column][1], m[column][2], w );
+
+                // The fourth row of a model matrix is (0, 0, 0, 1), which leaves three multiply-adds per element
+                L::Type mvp[4];
+                for ( GLuint row = 0; row < 4; row++ )
+                {
+                    mvp[row] = L::Add( L::Add( L::Mul( vp[0][row], m[column][0] ), L::Mul( vp[1][row], m[column][1] ) ), L::Mul( vp[2][row], m[column][2] ) );
+                    if ( 3 == column )
+                    {
+                        mvp[row] = L::Add( mvp[row], vp[3][row] );
+                    }
+                }
+                L::Store( out, offsetof( InstanceTransform, mvp ) / sizeof( GLfloat ) + column * 4, mvp[0], mvp[1], mvp[2], mvp[3] );
+            }
+
+            for ( GLuint column = 0; column < 3; column++ )
+            {
+                L::Store( out, offsetof( InstanceTransform, normal ) / sizeof( GLfloat ) + column * 4, r[column][0], r[column][1], r[column][2], zero );
+            }
+        }
+
+        if ( this->hasMeshTransform )
+        {
+            for ( size_t i = first; i < last; i++ )
+            {
+                this->instances[i].model = this->instances[i].model * this->meshTransform;
+                this->instances[i].mvp = this->instances[i].mvp * this->meshTransform;
+            }
+        }
+    }
+
+    // Results of the last Update, GetCount( ) of them are valid
+    const InstanceTransform *GetInstances( ) const
+    {
+        return this->instances.data( );
+    }
+
+    glm::vec3 GetPosition( GLuint i ) const
+    {
+        return glm::vec3( this->positionX[i], this->positionY[i], this->positionZ[i] );
+    }
+
+    GLuint GetCount( ) const
+    {
+        return this->count;
+    }
+
+private:
+    GLuint count;
+    std::vector<GLfloat> positionX, positionY, positionZ;
+    std::vector<GLfloat> scaleX, scaleY, scaleZ;
+    std::vector<GLfloat> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<InstanceTransform> instances;
+    glm::mat4 meshTransform;
+    bool hasMeshTransform;
+
+    // Grows or shrinks every array to 'count' rounded up to the lane width, anything past 'count' is reset to the identity transform
+    void resize( size_t count )
+    {
+        size_t padded = ( count + TransformLanes::WIDTH - 1 ) / TransformLanes::WIDTH * TransformLanes::WIDTH;
+        fit( this->positionX, count, padded, 0.0f );
+        fit( this->positionY, count, padded, 0.0f );
+        fit( this->positionZ, count, padded, 0.0f );
+        fit( this->scaleX, count, padded, 1.0f );
+        fit( this->scaleY, count, padded, 1.0f );
+        fit( this->scaleZ, count, padded, 1.0f );
+        fit( this->rotationX, count, padded, 0.0f );
+        fit( this->rotationY, count, padded, 0.0f );
+        fit( this->rotationZ, count, padded, 0.0f );
+        fit( this->rotationW, count, padded, 1.0f );
+        this->instances.resize( padded );
+    }
+
+    static void fit( std::vector<GLfloat> &values, size_t count, size_t padded, GLfloat value )
+    {
+        values.resize( std::min( values.size( ), count ) );
+        values.resize( padded, value );
+    }
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+// Std. Includes
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Hands values of T from one writing thread to one reading thread without either waiting for the other. Of three slots the
+// writer fills one, the reader reads one and the third holds the newest published value; publishing and taking a value are
+// a single atomic exchange of the writer's or the reader's slot with the third one. A published value is never touched again
+// until the reader is done with it, and a reader that falls behind skips straight to the newest value.
+//
+// The exchanges never block. The mutex and condition variable are only there for a thread that has nothing to do to sleep
+// on: the reader until something is published, the writer until the reader has taken what it published. They are only
+// touched when the other thread is asleep, which the count of sleeping threads tells as it does for JobSystem.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer( ) : back( 0 ), front( 1 ), middle( 2 ), sleeping( 0 ), closed( false )
+    {
+    }
+
+    // Writer only, the slot to fill before Publish
+    T &GetWriteBuffer( )
+    {
+        return this->slots[this->back];
+    }
+
+    // Writer only, makes the filled slot the newest value, replacing one the reader hasn't taken
+    void Publish( )
+    {
+        this->back = this->middle.exchange( this->back | FRESH, std::memory_order_seq_cst ) & INDEX;
+        this->notify( );
+    }
+
+    // Reader only, the value of the last WaitAndAcquire
+    const T &GetReadBuffer( ) const
+    {
+        return this->slots[this->front];
+    }
+
+    // Reader only, acquires the next value and sleeps until there is one. False once the buffer is closed.
+    bool WaitAndAcquire( )
+    {
+        while ( !this->take( ) )
+        {
+            std::unique_lock<std::mutex> lock( this->mutex );
+            this->sleeping.fetch_add( 1, std::memory_order_seq_cst );
+            while ( !this->closed && !this->isFresh( ) )
+            {
+                this->wake.wait( lock );
+            }
+            this->sleeping.fetch_sub( 1, std::memory_order_seq_cst );
+            if ( !this->isFresh( ) )
+            {
+                return false;
+            }
+        }
+        this->notify( );
+        return true;
+    }
+
+    // Writer only, sleeps until the reader has taken the last value published or 'timeout' seconds have passed
+    void WaitUntilRead( GLfloat timeout )
+    {
+        if ( !this->isFresh( ) )
+        {
+            return;
+        }
+        std::unique_lock<std::mutex> lock( this->mutex );
+        this->sleeping.fetch_add( 1, std::memory_order_seq_cst );
+        this->wake.wait_for( lock, std::chrono::duration<GLfloat>( timeout ), [this]( )
+        {
+            return !this->isFresh( );
+        } );
+        this->sleeping.fetch_sub( 1, std::memory_order_seq_cst );
+    }
+
+    // No more values will be published, wakes the reader
+    void Close( )
+    {
+        std::lock_guard<std::mutex> lock( this->mutex );
+        this->closed = true;
+        this->wake.notify_all( );
+    }
+
+private:
+    // The third slot's index and whether it was published since the reader took one
+    static const GLuint INDEX = 3;
+    static const GLuint FRESH = 4;
+
+    T slots[3];
+    GLuint back;
+    GLuint front;
+    std::atomic<GLuint> middle;
+    std::atomic<GLint> sleeping;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool closed;
+
+    bool isFresh( ) const
+    {
+        return 0 != ( this->middle.load( std::memory_order_seq_cst ) & FRESH );
+    }
+
+    // Swaps the reader's slot for the newest value, when one was published since the last swap
+    bool take( )
+    {
+        if ( !this->isFresh( ) )
+        {
+            return false;
+        }
+        this->front = this->middle.exchange( this->front, std::memory_order_seq_cst ) & INDEX;
+        return true;
+    }
+
+    // A thread about to sleep counts itself before it checks the buffer a last time, under the lock. Either it sees the
+    // exchange made before this, or this sees it counted and takes the lock, which it only lets go of once it waits.
+    void notify( )
+    {
+        if ( this->sleeping.load( std::memory_order_seq_cst ) > 0 )
+        {
+            std::lock_guard<std::mutex> lock( this->mutex );
+            this->wake.notify_all( );
+        }
+    }
+};
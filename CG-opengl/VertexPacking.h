@@ -0,0 +1,150 @@
+#pragma once
+
+// Std. Includes
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// GL Includes
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "BufferArena.h"
+
+// Vertex of 16 bytes instead of the 32 of eight floats, in two streams: PackedPosition for every pass and PackedAttributes
+// for the ones that shade. Positions are 16 bit integers counting steps of the mesh's bounds away from its center, which the
+// decode transform of VertexPacker turns back into mesh space; they go in as plain integers (not normalized) so the
+// conversion is exact on every GL version. Normals are signed normalized 10:10:10:2, texture coordinates unsigned
+// normalized 16 bit and have to lie in 0..1.
+struct PackedPosition
+{
+    // The fourth component is padding that keeps every position 8 byte aligned
+    GLshort position[4];
+};
+
+struct PackedAttributes
+{
+    GLuint normal;
+    GLushort texCoords[2];
+};
+
+static_assert( sizeof( PackedPosition ) + sizeof( PackedAttributes ) == 16, "Packed vertex streams must be tightly packed" );
+
+// Packs vertices of the float layout (position, normal, texture coordinates, 8 floats) into PackedPosition and
+// PackedAttributes
+class VertexPacker
+{
+public:
+    VertexPacker( ) : center( 0.0f ), step( 1.0f )
+    {
+    }
+
+    // Packs 'count' vertices. The quantization step is the bounds of the vertices over the 65535 values a short has, per
+    // axis, so the error grows with the size of the mesh: about 1.5 mm over the 200 units of the floor, but a couple of
+    // units for a flight of 100000 steps, which has to be split into pieces with bounds of their own.
+    void Pack( const GLfloat *vertices, GLuint count )
+    {
+        glm::vec3 min( vertices[0], vertices[1], vertices[2] ), max = min;
+        for ( GLuint i = 1; i < count; i++ )
+        {
+            glm::vec3 position( vertices[i * VERTEX_FLOATS], vertices[i * VERTEX_FLOATS + 1], vertices[i * VERTEX_FLOATS + 2] );
+            min = glm::min( min, position );
+            max = glm::max( max, position );
+        }
+        this->center = 0.5f * ( min + max );
+        for ( GLuint axis = 0; axis < 3; axis++ )
+        {
+            GLfloat halfExtent = 0.5f * ( max[axis] - min[axis] );
+            this->step[axis] = ( halfExtent > 0.0f ) ? halfExtent / 32767.0f : 1.0f;
+        }
+
+        this->positions.resize( count );
+        this->attributes.resize( count );
+        for ( GLuint i = 0; i < count; i++ )
+        {
+            const GLfloat *vertex = &vertices[i * VERTEX_FLOATS];
+            PackedPosition &position = this->positions[i];
+            for ( GLuint axis = 0; axis < 3; axis++ )
+            {
+                position.position[axis] = ( GLshort )std::lround( ( vertex[axis] - this->center[axis] ) / this->step[axis] );
+            }
+            position.position[3] = 0;
+            this->attributes[i].normal = packNormal( glm::vec3( vertex[3], vertex[4], vertex[5] ) );
+            this->attributes[i].texCoords[0] = packUnorm16( vertex[6] );
+            this->attributes[i].texCoords[1] = packUnorm16( vertex[7] );
+        }
+    }
+
+    const std::vector<PackedPosition> &GetPositions( ) const
+    {
+        return this->positions;
+    }
+
+    // Matrix from the packed positions to mesh space, applied after the model matrix of every object drawing them
+    glm::mat4 GetDecodeTransform( ) const
+    {
+        return glm::scale( glm::translate( glm::mat4( ), this->center ), this->step );
+    }
+
+    // Copy one of the streams into a range of 'arena', starting on a whole vertex
+    BufferRange UploadPositions( BufferArena &arena ) const
+    {
+        return arena.Upload( this->positions.data( ), ( GLuint )( this->positions.size( ) * sizeof( PackedPosition ) ), sizeof( PackedPosition ) );
+    }
+
+    BufferRange UploadAttributes( BufferArena &arena ) const
+    {
+        return arena.Upload( this->attributes.data( ), ( GLuint )( this->attributes.size( ) * sizeof( PackedAttributes ) ), sizeof( PackedAttributes ) );
+    }
+
+    // Point attribute 0, or attributes 1 and 2, of the bound VAO at the stream 'offset' bytes into the bound GL_ARRAY_BUFFER
+    static void SetPositionAttribute( GLuint offset )
+    {
+        glVertexAttribPointer( 0, 3, GL_SHORT, GL_FALSE, sizeof( PackedPosition ), ( GLvoid * )( offset + offsetof( PackedPosition, position ) ) );
+        glEnableVertexAttribArray( 0 );
+    }
+
+    static void SetOtherAttributes( GLuint offset )
+    {
+        glVertexAttribPointer( 1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof( PackedAttributes ), ( GLvoid * )( offset + offsetof( PackedAttributes, normal ) ) );
+        glEnableVertexAttribArray( 1 );
+        glVertexAttribPointer( 2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof( PackedAttributes ), ( GLvoid * )( offset + offsetof( PackedAttributes, texCoords ) ) );
+        glEnableVertexAttribArray( 2 );
+    }
+
+    GLuint GetVertexCount( ) const
+    {
+        return ( GLuint )this->positions.size( );
+    }
+
+private:
+    static const GLuint VERTEX_FLOATS = 8;
+
+    glm::vec3 center;
+    glm::vec3 step;
+    std::vector<PackedPosition> positions;
+    std::vector<PackedAttributes> attributes;
+
+    // x, y and z in the low 30 bits, 10 each, as 511ths. GL 3.3 decodes them as (2c + 1) / 1023 and 4.2 as c / 511, both
+    // within a thousandth of the normal, which the shaders renormalize anyway.
+    static GLuint packNormal( glm::vec3 normal )
+    {
+        GLuint packed = 0;
+        for ( GLuint axis = 0; axis < 3; axis++ )
+        {
+            GLfloat value = normal[axis] < -1.0f ? -1.0f : normal[axis] > 1.0f ? 1.0f : normal[axis];
+            packed |= ( ( GLuint )( ( int32_t )std::lround( value * 511.0f ) ) & 0x3FF ) << ( 10 * axis );
+        }
+        return packed;
+    }
+
+    static GLushort packUnorm16( GLfloat value )
+    {
+        value = value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value;
+        return ( GLushort )std::lround( value * 65535.0f );
+    }
+};
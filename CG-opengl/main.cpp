@@ -1,6 +1,12 @@
 #include <iostream>
 #include <cmath>
 #include <math.h>
+#include <cfloat>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <random>
 
 // GLEW
 #define GLEW_STATIC
@@ -20,6 +26,27 @@
 // Other includes
 #include "Shader.h"
 #include "Camera.h"
+#include "Lights.h"
+#include "Clusters.h"
+#include "Benchmark.h"
+#include "GBuffer.h"
+#include "Instancing.h"
+#include "GLState.h"
+#include "RenderQueue.h"
+#include "FragmentCounter.h"
+#include "Frustum.h"
+#include "BVH.h"
+#include "Occlusion.h"
+#include "SoftwareOcclusion.h"
+#include "Staircase.h"
+#include "MeshOptimizer.h"
+#include "VertexPacking.h"
+#include "StaticBatch.h"
+#include "BufferArena.h"
+#include "CubeSimulation.h"
+#include "FixedTimestep.h"
+#include "JobSystem.h"
+#include "TripleBuffer.h"
 
 
 // Function prototypes
@@ -38,13 +65,111 @@ GLfloat lastY = HEIGHT / 2.0;
 bool keys[1024];
 bool firstMouse = true;
 
-// Light attributes
-glm::vec3 lightPos( 1.2f, 1.0f, 2.0f );
+// Uniform names, hashed at compile time so setting a uniform never needs a string lookup
+constexpr GLuint UNIFORM_VIEW = UniformHash( "view" );
+constexpr GLuint UNIFORM_PROJECTION = UniformHash( "projection" );
+constexpr GLuint UNIFORM_VIEW_POS = UniformHash( "viewPos" );
+constexpr GLuint UNIFORM_MATERIAL_DIFFUSE = UniformHash( "material.diffuse" );
+constexpr GLuint UNIFORM_MATERIAL_SPECULAR = UniformHash( "material.specular" );
+constexpr GLuint UNIFORM_MATERIAL_SHININESS = UniformHash( "material.shininess" );
+constexpr GLuint UNIFORM_BLOCK_LIGHTS = UniformHash( "Lights" );
+constexpr GLuint UNIFORM_NEAR_PLANE = UniformHash( "nearPlane" );
+constexpr GLuint UNIFORM_G_POSITION = UniformHash( "gPosition" );
+constexpr GLuint UNIFORM_G_NORMAL = UniformHash( "gNormal" );
+constexpr GLuint UNIFORM_G_ALBEDO_SPEC = UniformHash( "gAlbedoSpec" );
+
+// Lighting pipelines, switched at runtime with the number keys
+enum LightingMode
+{
+    LIGHTING_FORWARD,       // 1: every fragment loops over the 14 lights of the uniform block
+    LIGHTING_CLUSTERED,     // 2: every fragment loops over the lights of its cluster only
+    LIGHTING_DEFERRED       // 3: G-buffer pass, then every light shades only the pixels it covers
+};
+LightingMode lightingMode = LIGHTING_FORWARD;
+
+// Lays down the depth of the opaque geometry first, so the lit pass only shades the fragments that end up visible
+bool depthPrepass = false;
+
+// Occlusion culling of the falling cubes and the lamps, cycled at runtime with 5
+enum OcclusionMode
+{
+    OCCLUSION_NONE,
+    OCCLUSION_QUERIES,      // every object is drawn on its own, skipped by the GPU when its box was hidden in the previous frame
+    OCCLUSION_SOFTWARE      // the staircase is rasterized on the CPU and hidden objects are dropped before anything is drawn
+};
+OcclusionMode occlusionMode = OCCLUSION_NONE;
+
+// Projection planes, the cluster grid slices the depth range between them
+const GLfloat NEAR_PLANE = 0.1f, FAR_PLANE = 100.0f;
+
+// Staircase of the scene and of the CPU benchmarks, '--staircase-steps N', '--staircase-rise R', '--staircase-run R' and
+// '--staircase-width W' change it
+GLuint staircaseSteps = 28;
+GLfloat staircaseRise = 0.3f, staircaseRun = 1.0f, staircaseWidth = 10.0f;
+// Where the scene's staircase stands, the falling cubes bounce down it
+const glm::vec3 STAIRCASE_ORIGIN( -2.0f, -2.5f, 0.0f );
+
+// The game is simulated in steps of fixed length, up to a limit of steps per frame, see FixedTimestep.h
+const GLfloat SIMULATION_STEP = 1.0f / 60.0f;
+const GLuint MAX_SIMULATION_STEPS = 5;
+
+// Size of the falling cubes, and the seconds of their way the boxes they are culled with cover, see UpdateCubeBounds
+const GLfloat CUBE_SCALE = 0.3f, CUBE_BOUNDS_TIME = 0.25f;
+
+// Items per job of the work split over the job system: falling cubes, transforms and boxes. Multiples of the widest lanes.
+const size_t CUBE_JOB_CHUNK = 1024, TRANSFORM_JOB_CHUNK = 256, CULL_JOB_CHUNK = 2048;
+
+// Bytes of the vertex and the index buffer every mesh shares
+const GLuint VERTEX_ARENA_SIZE = 4 << 20, INDEX_ARENA_SIZE = 1 << 20;
+
+// Stages of the '--bench-lights' run
+const GLuint BENCH_LIGHTS_STAGES = 11;
+const LightingMode BENCH_LIGHTS_MODES[BENCH_LIGHTS_STAGES] =
+{
+    LIGHTING_FORWARD,
+    LIGHTING_CLUSTERED, LIGHTING_CLUSTERED, LIGHTING_CLUSTERED, LIGHTING_CLUSTERED, LIGHTING_CLUSTERED,
+    LIGHTING_DEFERRED, LIGHTING_DEFERRED, LIGHTING_DEFERRED, LIGHTING_DEFERRED, LIGHTING_DEFERRED
+};
+const GLuint BENCH_LIGHTS_COUNTS[BENCH_LIGHTS_STAGES] = { 14, 14, 64, 256, 1024, 4096, 14, 64, 256, 1024, 4096 };
+const char *LIGHTING_MODE_NAMES[] = { "forward", "clustered", "deferred" };
+
+// Stages of the '--bench-shading' run, the forward lit pass with lighting_reference.frag against lighting.frag
+const GLuint BENCH_SHADING_STAGES = 2;
+const char *BENCH_SHADING_NAMES[BENCH_SHADING_STAGES] = { "reference lighting.frag", "optimized lighting.frag" };
+
+// Which benchmark was asked for on the command line
+enum BenchmarkRun
+{
+    BENCH_NONE,
+    BENCH_LIGHTS,
+    BENCH_SHADING
+};
+
+// Use lighting_reference.frag instead of lighting.frag for the forward path
+bool referenceShading = false;
 
 // Deltatime
 GLfloat deltaTime = 0.0f;    // Time between current frame and last frame
 GLfloat lastFrame = 0.0f;      // Time of last frame
 
+// Everything the render thread draws a frame from, written by the input and simulation thread and never changed once it is
+// published. The camera, the settings switched with the keys and the falling cubes only change on that thread, and the
+// render thread never reads them anywhere else.
+struct FrameSnapshot
+{
+    GLfloat time;
+    glm::vec3 cameraPosition;
+    glm::vec3 cameraFront;
+    glm::mat4 view;
+    LightingMode lightingMode;
+    bool depthPrepass;
+    OcclusionMode occlusionMode;
+    // Falling cubes in all, the ones in the view and where those are
+    GLuint cubeCount;
+    std::vector<GLuint> visibleCubes;
+    std::vector<glm::vec3> cubePositions;
+};
+
 float RandomFloat(float a, float b) {
     float random = ((float) rand()) / (float) RAND_MAX;
     float diff = b - a;
@@ -52,9 +177,762 @@ float RandomFloat(float a, float b) {
     return a + r;
 }
 
+// Point light with the colors used on the staircase
+PointLightData MakePointLight( glm::vec3 position, GLfloat linear, GLfloat quadratic )
+{
+    PointLightData light = PointLightData( );
+    light.position = position;
+    light.ambient = glm::vec3( 0.2f, 0.2f, 0.2f );
+    light.diffuse = glm::vec3( 0.5f, 0.5f, 0.5f );
+    light.specular = glm::vec3( 1.0f, 1.0f, 1.0f );
+    light.constant = 1.0f;
+    light.linear = linear;
+    light.quadratic = quadratic;
+    return light;
+}
+
+// Fills the scene with count point lights: the fixed staircase lamps first, then short range lights scattered over the staircase
+void GenerateSceneLights( std::vector<PointLightData> &lights, GLuint count, const glm::vec3 *fixedPositions, GLuint fixedCount )
+{
+    lights.clear( );
+    for ( GLuint i = 0; i < count; i++ )
+    {
+        if ( i < fixedCount )
+        {
+            lights.push_back( MakePointLight( fixedPositions[i], 0.09f, 0.032f ) );
+        }
+        else
+        {
+            lights.push_back( MakePointLight( glm::vec3( RandomFloat( -6.9f, 2.9f ), RandomFloat( 0.0f, 16.0f ), RandomFloat( -60.0f, 0.0f ) ), 0.35f, 0.44f ) );
+        }
+    }
+}
+
+// Issued and dropped GL calls of the last frame, per kind
+void PrintGLStats( )
+{
+    const char *kinds[GLState::CALL_KINDS] = { "program", "vertex array", "buffer", "texture", "uniform" };
+    std::cout << "GL calls issued/dropped last frame:";
+    for ( GLuint i = 0; i < GLState::CALL_KINDS; i++ )
+    {
+        GLState::Call kind = ( GLState::Call )i;
+        std::cout << " " << kinds[i] << " " << GLState::Get( ).GetIssued( kind ) << "/" << GLState::Get( ).GetDropped( kind );
+    }
+    std::cout << std::endl;
+}
+
+// Distance from the camera to the closest object of a group, orders instanced draws front to back
+GLfloat NearestDistance( const TransformSystem &transforms, glm::vec3 eye )
+{
+    GLfloat nearest = FAR_PLANE;
+    for ( GLuint i = 0; i < transforms.GetCount( ); i++ )
+    {
+        nearest = std::min( nearest, glm::distance( transforms.GetPosition( i ), eye ) );
+    }
+    return nearest;
+}
+
+// The same for the listed objects of the group only, the ones drawn
+GLfloat NearestDistance( const TransformSystem &transforms, const std::vector<GLuint> &objects, glm::vec3 eye )
+{
+    GLfloat nearest = FAR_PLANE;
+    for ( size_t i = 0; i < objects.size( ); i++ )
+    {
+        nearest = std::min( nearest, glm::distance( transforms.GetPosition( objects[i] ), eye ) );
+    }
+    return nearest;
+}
+
+// Boxes around instances of the unit cube mesh, which are only ever moved and scaled by 'scale'
+void SetCubeBoxes( BoxCuller &culler, const TransformSystem &transforms, GLfloat scale )
+{
+    glm::vec3 halfSize( 0.5f * scale );
+    culler.Resize( transforms.GetCount( ) );
+    for ( GLuint i = 0; i < transforms.GetCount( ); i++ )
+    {
+        culler.SetBox( i, transforms.GetPosition( i ) - halfSize, transforms.GetPosition( i ) + halfSize );
+    }
+}
+
+// BoxCuller::Cull with the boxes tested on the job system, 'inside' holds the bits of the test
+void CullBoxes( JobSystem &jobs, const BoxCuller &culler, const Frustum &frustum, std::vector<GLuint> &inside, std::vector<GLuint> &visible )
+{
+    inside.resize( ( culler.GetCount( ) + BoxCuller::LANES - 1 ) / BoxCuller::LANES );
+    jobs.ParallelFor( culler.GetCount( ), CULL_JOB_CHUNK, [&]( size_t first, size_t last )
+    {
+        culler.Test( frustum, first, last, inside.data( ) );
+    } );
+    culler.Collect( inside.data( ), visible );
+}
+
+// Builds the matrices of every object of 'transforms' on the job system
+void UpdateTransforms( JobSystem &jobs, TransformSystem &transforms, const glm::mat4 &viewProjection )
+{
+    jobs.ParallelFor( transforms.GetCount( ), TRANSFORM_JOB_CHUNK, [&]( size_t first, size_t last )
+    {
+        transforms.Update( viewProjection, first, last );
+    } );
+}
+
+// UpdateTransforms for the listed objects only, in increasing order. The blocks of the lane width holding them are built,
+// 'blocks' holds their first objects, and every other object keeps the matrices it had.
+void UpdateListedTransforms( JobSystem &jobs, TransformSystem &transforms, const std::vector<GLuint> &objects, const glm::mat4 &viewProjection, std::vector<GLuint> &blocks )
+{
+    blocks.clear( );
+    for ( size_t i = 0; i < objects.size( ); i++ )
+    {
+        GLuint block = ( GLuint )( objects[i] / TransformLanes::WIDTH * TransformLanes::WIDTH );
+        if ( blocks.empty( ) || blocks.back( ) != block )
+        {
+            blocks.push_back( block );
+        }
+    }
+    jobs.ParallelFor( blocks.size( ), TRANSFORM_JOB_CHUNK / TransformLanes::WIDTH, [&]( size_t first, size_t last )
+    {
+        for ( size_t i = first; i < last; i++ )
+        {
+            transforms.Update( viewProjection, blocks[i], blocks[i] + 1 );
+        }
+    } );
+}
+
+// Keeps 'bounds' boxes around where the falling cubes go over CUBE_BOUNDS_TIME from 'boundsStart' on. They are only
+// rebuilt, on the job system, when [from, to] leaves that window or cubes were added; returns whether they were.
+bool UpdateCubeBounds( JobSystem &jobs, const CubeSimulation &cubes, GLfloat from, GLfloat to, BoxCuller &bounds, GLfloat &boundsStart )
+{
+    if ( bounds.GetCount( ) == cubes.GetCount( ) && from >= boundsStart && to <= boundsStart + CUBE_BOUNDS_TIME )
+    {
+        return false;
+    }
+
+    boundsStart = from;
+    glm::vec3 halfSize( 0.5f * CUBE_SCALE );
+    bounds.Resize( cubes.GetCount( ) );
+    jobs.ParallelFor( cubes.GetCount( ), CUBE_JOB_CHUNK, [&]( size_t first, size_t last )
+    {
+        for ( size_t i = first; i < last; i++ )
+        {
+            glm::vec3 min, max;
+            cubes.GetBounds( ( GLuint )i, boundsStart, boundsStart + CUBE_BOUNDS_TIME, min, max );
+            bounds.SetBox( ( GLuint )i, min - halfSize, max + halfSize );
+        }
+    } );
+    return true;
+}
+
+// Where the cubes of 'indices' are at 'time', on the job system. Cubes not in the list cost nothing.
+void EvaluateCubes( JobSystem &jobs, const CubeSimulation &cubes, const std::vector<GLuint> &indices, GLfloat time, std::vector<glm::vec3> &positions )
+{
+    positions.resize( indices.size( ) );
+    jobs.ParallelFor( indices.size( ), CUBE_JOB_CHUNK, [&]( size_t first, size_t last )
+    {
+        for ( size_t i = first; i < last; i++ )
+        {
+            positions[i] = cubes.GetPositionAt( indices[i], time );
+        }
+    } );
+}
+
+// Turns the visible segments of a mesh starting at 'meshFirst', 'segmentSize' vertices or indices each, into draw ranges.
+// Neighbouring segments are merged into one range.
+void BuildDrawRanges( const std::vector<GLuint> &segments, GLint meshFirst, GLsizei segmentSize, std::vector<GLint> &firsts, std::vector<GLsizei> &counts )
+{
+    firsts.clear( );
+    counts.clear( );
+    for ( size_t i = 0; i < segments.size( ); i++ )
+    {
+        GLint first = meshFirst + ( GLint )segments[i] * segmentSize;
+        if ( !firsts.empty( ) && firsts.back( ) + counts.back( ) == first )
+        {
+            counts.back( ) += segmentSize;
+        }
+        else
+        {
+            firsts.push_back( first );
+            counts.push_back( segmentSize );
+        }
+    }
+}
+
+// Copy of a geometry draw for the depth pre-pass, position only and without textures
+DrawPacket DepthOnly( DrawPacket packet, Shader &depthShader )
+{
+    packet.shader = &depthShader;
+    packet.textureSet = 0;
+    if ( 0 != packet.positionVAO )
+    {
+        packet.VAO = packet.positionVAO;
+    }
+    return packet;
+}
+
+// Queues a group of instances uploaded from the 'visible' objects of 'transforms'. Without occlusion culling that is one
+// instanced draw, with it every instance is a draw of its own conditioned on its object's query. A depth shader adds the
+// same draws to the depth pre-pass. Draws are ordered by their distance to 'eye'.
+void SubmitInstances( RenderQueue &queue, RenderPass pass, DrawPacket packet, const std::vector<GLuint> &visible, const TransformSystem &transforms, const OcclusionCuller *occlusion, Shader *depthShader, const glm::vec3 &eye )
+{
+    if ( NULL == occlusion )
+    {
+        GLfloat distance = NearestDistance( transforms, visible, eye );
+        queue.Submit( pass, distance, packet );
+        if ( NULL != depthShader )
+        {
+            queue.Submit( PASS_DEPTH, distance, DepthOnly( packet, *depthShader ) );
+        }
+        return;
+    }
+
+    for ( GLuint i = 0; i < visible.size( ); i++ )
+    {
+        DrawPacket single = packet;
+        single.instanceCount = 1;
+        single.firstInstance = i;
+        single.condition = occlusion->GetCondition( visible[i] );
+        GLfloat distance = glm::distance( transforms.GetPosition( visible[i] ), eye );
+        queue.Submit( pass, distance, single );
+        if ( NULL != depthShader )
+        {
+            queue.Submit( PASS_DEPTH, distance, DepthOnly( single, *depthShader ) );
+        }
+    }
+}
+
+// Queues the 'visible' objects of a static batch, drawn with the batch's single identity instance. Without occlusion culling
+// that is one multi-draw of their index ranges, kept in 'firsts' and 'counts' until the queue has run, with it every object
+// is a draw of its own conditioned on its query. 'transforms' has the positions of the objects for the draw order, by their
+// distance to 'eye'.
+void SubmitBatch( RenderQueue &queue, RenderPass pass, DrawPacket packet, const std::vector<GLuint> &visible, const StaticBatch &batch, std::vector<GLint> &firsts, std::vector<GLsizei> &counts, const TransformSystem &transforms, const OcclusionCuller *occlusion, const glm::vec3 &eye )
+{
+    if ( NULL == occlusion )
+    {
+        batch.BuildDrawRanges( visible, firsts, counts );
+        packet.firsts = firsts.data( );
+        packet.counts = counts.data( );
+        packet.drawCount = ( GLsizei )firsts.size( );
+        queue.Submit( pass, NearestDistance( transforms, eye ), packet );
+        return;
+    }
+
+    for ( GLuint i = 0; i < visible.size( ); i++ )
+    {
+        DrawPacket single = packet;
+        single.first = ( GLint )batch.GetFirstIndex( visible[i] );
+        single.count = ( GLsizei )batch.GetIndexCount( visible[i] );
+        single.condition = occlusion->GetCondition( visible[i] );
+        queue.Submit( pass, glm::distance( transforms.GetPosition( visible[i] ), eye ), single );
+    }
+}
+
+// One small cube per point light
+void SetLampTransforms( TransformSystem &lamps, const std::vector<PointLightData> &lights )
+{
+    lamps.Clear( );
+    for ( size_t i = 0; i < lights.size( ); i++ )
+    {
+        lamps.Add( lights[i].position, glm::vec3( 0.2f ) ); // Make it a smaller cube
+    }
+}
+
+// Boxes of a staircase for '--bench-bvh', made by the generator of the scene's staircase with its rise, run and width: one
+// box per quad, in the order of the mesh, and one per lamp with a pair of lamps for every fourth step. Returns the center of
+// every tread, where the queries are placed.
+std::vector<glm::vec3> GenerateStaircaseBoxes( GLuint steps, std::vector<AABB> &boxes )
+{
+    Staircase staircase;
+    staircase.Generate( steps, staircaseRise, staircaseRun, staircaseWidth );
+    boxes.assign( staircase.GetQuadCount( ), AABB( ) );
+    for ( GLuint quad = 0; quad < staircase.GetQuadCount( ); quad++ )
+    {
+        for ( GLuint i = quad * Staircase::QUAD_INDICES; i < ( quad + 1 ) * Staircase::QUAD_INDICES; i++ )
+        {
+            boxes[quad].Grow( staircase.GetPosition( i ) );
+        }
+    }
+
+    std::vector<glm::vec3> lamps = staircase.GetLampPositions( ( steps + 3 ) / 4 );
+    for ( size_t i = 0; i < lamps.size( ); i++ )
+    {
+        boxes.push_back( AABB( lamps[i] - glm::vec3( 0.1f ), lamps[i] + glm::vec3( 0.1f ) ) );
+    }
+
+    std::vector<glm::vec3> centers;
+    for ( GLuint i = 0; i <= steps; i++ )
+    {
+        centers.push_back( staircase.GetTreadCenter( i ) );
+    }
+    return centers;
+}
+
+// '--bench-bvh': build time and query throughput of the BVH on generated staircases of 10^3 to 10^6 steps
+void BenchmarkBVH( )
+{
+    const GLuint STAGES = 4;
+    const GLuint STEPS[STAGES] = { 1000, 10000, 100000, 1000000 };
+    const GLuint FRUSTUM_QUERIES = 1000, RAY_QUERIES = 100000, BOX_QUERIES = 100000;
+    glm::mat4 projection = glm::perspective( glm::radians( 45.0f ), ( GLfloat )WIDTH / ( GLfloat )HEIGHT, NEAR_PLANE, FAR_PLANE );
+
+    std::cout << "== BVH over generated staircases ==" << std::endl;
+    std::cout << std::left << std::setw( 10 ) << "steps" << std::right << std::setw( 12 ) << "primitives" << std::setw( 10 ) << "nodes"
+              << std::setw( 12 ) << "build ms" << std::setw( 14 ) << "frustum us" << std::setw( 10 ) << "visible"
+              << std::setw( 12 ) << "Mrays/s" << std::setw( 14 ) << "box Mq/s" << std::endl;
+    std::cout << std::fixed << std::setprecision( 3 );
+    srand( 1 );
+    for ( GLuint stage = 0; stage < STAGES; stage++ )
+    {
+        std::vector<AABB> boxes;
+        std::vector<glm::vec3> centers = GenerateStaircaseBoxes( STEPS[stage], boxes );
+
+        BVH bvh;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+        bvh.Build( boxes );
+        std::chrono::duration<double, std::milli> build = std::chrono::steady_clock::now( ) - start;
+
+        // Cameras standing on random steps looking up the staircase
+        std::vector<GLuint> result;
+        size_t visible = 0;
+        start = std::chrono::steady_clock::now( );
+        for ( GLuint i = 0; i < FRUSTUM_QUERIES; i++ )
+        {
+            glm::vec3 eye = centers[rand( ) % centers.size( )] + glm::vec3( 0.0f, 1.7f, 0.0f );
+            glm::vec3 target = eye + glm::vec3( RandomFloat( -1.0f, 1.0f ), RandomFloat( -0.2f, 0.5f ), RandomFloat( -1.0f, 1.0f ) );
+            result.clear( );
+            bvh.QueryFrustum( Frustum( projection * glm::lookAt( eye, target, glm::vec3( 0.0f, 1.0f, 0.0f ) ) ), result );
+            visible += result.size( );
+        }
+        std::chrono::duration<double, std::micro> frustum = std::chrono::steady_clock::now( ) - start;
+
+        // Rays from random steps in random directions, as a picking or line of sight test would cast them
+        GLuint hits = 0;
+        start = std::chrono::steady_clock::now( );
+        for ( GLuint i = 0; i < RAY_QUERIES; i++ )
+        {
+            glm::vec3 origin = centers[rand( ) % centers.size( )] + glm::vec3( 0.0f, 1.0f, 0.0f );
+            glm::vec3 direction = glm::normalize( glm::vec3( RandomFloat( -1.0f, 1.0f ), RandomFloat( -1.0f, 1.0f ), RandomFloat( -1.0f, 1.0f ) ) );
+            GLfloat distance = FAR_PLANE;
+            GLuint primitive;
+            hits += bvh.Raycast( origin, direction, distance, primitive ) ? 1 : 0;
+        }
+        std::chrono::duration<double> rays = std::chrono::steady_clock::now( ) - start;
+
+        // Boxes the size of a falling cube's neighbourhood, as a collision test would ask
+        start = std::chrono::steady_clock::now( );
+        for ( GLuint i = 0; i < BOX_QUERIES; i++ )
+        {
+            glm::vec3 center = centers[rand( ) % centers.size( )] + glm::vec3( 0.0f, 0.5f, 0.0f );
+            result.clear( );
+            bvh.QueryBox( AABB( center - glm::vec3( 0.5f ), center + glm::vec3( 0.5f ) ), result );
+        }
+        std::chrono::duration<double> boxQueries = std::chrono::steady_clock::now( ) - start;
+
+        std::cout << std::left << std::setw( 10 ) << STEPS[stage] << std::right << std::setw( 12 ) << bvh.GetPrimitiveCount( ) << std::setw( 10 ) << bvh.GetNodeCount( )
+                  << std::setw( 12 ) << build.count( ) << std::setw( 14 ) << frustum.count( ) / FRUSTUM_QUERIES << std::setw( 10 ) << visible / FRUSTUM_QUERIES
+                  << std::setw( 12 ) << RAY_QUERIES / rays.count( ) / 1.0e6 << std::setw( 14 ) << BOX_QUERIES / boxQueries.count( ) / 1.0e6 << std::endl;
+    }
+}
+
+// Smooth shaded grid of size x size quads as a non-indexed triangle list in random triangle order, the way an unoptimized
+// export of a terrain patch comes in. Position only.
+std::vector<GLfloat> GenerateGridTriangles( GLuint size )
+{
+    const GLuint corners[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 1, 1 }, { 0, 1 }, { 0, 0 } };
+    std::vector<GLuint> order( 2 * size * size );
+    for ( GLuint i = 0; i < order.size( ); i++ )
+    {
+        order[i] = i;
+    }
+    // Seeded, so every run of the benchmark measures the same triangle order
+    std::mt19937 random( size );
+    std::shuffle( order.begin( ), order.end( ), random );
+
+    std::vector<GLfloat> vertices;
+    for ( GLuint i = 0; i < order.size( ); i++ )
+    {
+        GLuint quad = order[i] / 2, half = order[i] % 2;
+        for ( GLuint c = 3 * half; c < 3 * half + 3; c++ )
+        {
+            GLfloat x = ( GLfloat )( quad % size + corners[c][0] ), z = ( GLfloat )( quad / size + corners[c][1] );
+            vertices.push_back( x );
+            vertices.push_back( 0.1f * std::sin( x ) * std::cos( z ) );
+            vertices.push_back( z );
+        }
+    }
+    return vertices;
+}
+
+// '--bench-meshes': what MeshOptimizer does to generated staircases and grids that come in as non-indexed triangle lists,
+// with ACMR measured against a FIFO cache of MeshOptimizer::FIFO_CACHE_SIZE entries, then the packed vertex format and the
+// allocator of the buffer arena
+void BenchmarkMeshes( )
+{
+    const GLuint STAGES = 4;
+    const std::string NAMES[STAGES] = { "staircase " + std::to_string( staircaseSteps ), "staircase 100000", "grid 128", "grid 256" };
+    srand( 1 );
+
+    std::cout << "== Mesh optimization, ACMR with a " << MeshOptimizer::FIFO_CACHE_SIZE << " entry FIFO ==" << std::endl;
+    std::cout << std::left << std::setw( 18 ) << "mesh" << std::right << std::setw( 10 ) << "triangles" << std::setw( 10 ) << "vertices"
+              << std::setw( 10 ) << "welded" << std::setw( 10 ) << "ACMR in" << std::setw( 10 ) << "welded" << std::setw( 10 ) << "ordered"
+              << std::setw( 10 ) << "weld ms" << std::setw( 10 ) << "order ms" << std::setw( 10 ) << "fetch ms" << std::setw( 14 ) << "index bytes" << std::endl;
+    std::cout << std::fixed << std::setprecision( 3 );
+    for ( GLuint stage = 0; stage < STAGES; stage++ )
+    {
+        // Both kinds of mesh are expanded into plain triangle lists first, the input welding has to undo
+        std::vector<GLfloat> vertices;
+        GLuint vertexFloats = 3;
+        if ( stage < 2 )
+        {
+            Staircase staircase;
+            staircase.Generate( ( 0 == stage ) ? staircaseSteps : 100000, staircaseRise, staircaseRun, staircaseWidth );
+            vertexFloats = Staircase::VERTEX_FLOATS;
+            for ( size_t i = 0; i < staircase.GetIndices( ).size( ); i++ )
+            {
+                const GLfloat *vertex = &staircase.GetVertices( )[staircase.GetIndices( )[i] * vertexFloats];
+                vertices.insert( vertices.end( ), vertex, vertex + vertexFloats );
+            }
+        }
+        else
+        {
+            vertices = GenerateGridTriangles( ( 2 == stage ) ? 128 : 256 );
+        }
+        GLuint vertexCount = ( GLuint )( vertices.size( ) / vertexFloats );
+
+        MeshOptimizer mesh;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+        mesh.LoadTriangles( vertices.data( ), vertexCount, vertexFloats );
+        std::chrono::duration<double, std::milli> weld = std::chrono::steady_clock::now( ) - start;
+        GLfloat weldedACMR = mesh.GetACMR( );
+
+        start = std::chrono::steady_clock::now( );
+        mesh.OptimizeVertexCache( );
+        std::chrono::duration<double, std::milli> order = std::chrono::steady_clock::now( ) - start;
+        start = std::chrono::steady_clock::now( );
+        mesh.OptimizeVertexFetch( );
+        std::chrono::duration<double, std::milli> fetch = std::chrono::steady_clock::now( ) - start;
+
+        size_t indexBytes = mesh.GetIndexCount( ) * ( ( GL_UNSIGNED_SHORT == mesh.GetIndexType( ) ) ? sizeof( GLushort ) : sizeof( GLuint ) );
+        std::cout << std::left << std::setw( 18 ) << NAMES[stage] << std::right << std::setw( 10 ) << vertexCount / 3 << std::setw( 10 ) << vertexCount
+                  << std::setw( 10 ) << mesh.GetVertexCount( ) << std::setw( 10 ) << 3.0f << std::setw( 10 ) << weldedACMR << std::setw( 10 ) << mesh.GetACMR( )
+                  << std::setw( 10 ) << weld.count( ) << std::setw( 10 ) << order.count( ) << std::setw( 10 ) << fetch.count( ) << std::setw( 14 ) << indexBytes << std::endl;
+    }
+
+    // What '--packed-vertices' saves on staircases, and how far the packed positions end up from the float ones
+    const GLuint PACKED_STAGES = 3;
+    const GLuint PACKED_STEPS[PACKED_STAGES] = { staircaseSteps, 1000, 100000 };
+    std::cout << std::endl << "== Staircase vertex memory, float vs packed ==" << std::endl;
+    std::cout << std::left << std::setw( 10 ) << "steps" << std::right << std::setw( 10 ) << "vertices" << std::setw( 14 ) << "float bytes"
+              << std::setw( 14 ) << "packed bytes" << std::setw( 8 ) << "ratio" << std::setw( 14 ) << "max error" << std::endl;
+    for ( GLuint stage = 0; stage < PACKED_STAGES; stage++ )
+    {
+        Staircase staircase;
+        staircase.Generate( PACKED_STEPS[stage], staircaseRise, staircaseRun, staircaseWidth );
+        GLuint vertexCount = ( GLuint )( staircase.GetVertices( ).size( ) / Staircase::VERTEX_FLOATS );
+        VertexPacker packer;
+        packer.Pack( staircase.GetVertices( ).data( ), vertexCount );
+
+        // Decoded the way the vertex shader does it, through the decode transform
+        glm::mat4 decode = packer.GetDecodeTransform( );
+        GLfloat maxError = 0.0f;
+        for ( GLuint i = 0; i < vertexCount; i++ )
+        {
+            const GLfloat *vertex = &staircase.GetVertices( )[i * Staircase::VERTEX_FLOATS];
+            const GLshort *position = packer.GetPositions( )[i].position;
+            glm::vec3 packed = glm::vec3( decode * glm::vec4( position[0], position[1], position[2], 1.0f ) );
+            maxError = std::max( maxError, glm::length( packed - glm::vec3( vertex[0], vertex[1], vertex[2] ) ) );
+        }
+
+        size_t floatBytes = staircase.GetVertices( ).size( ) * sizeof( GLfloat ), packedBytes = vertexCount * ( sizeof( PackedPosition ) + sizeof( PackedAttributes ) );
+        std::cout << std::left << std::setw( 10 ) << PACKED_STEPS[stage] << std::right << std::setw( 10 ) << vertexCount << std::setw( 14 ) << floatBytes
+                  << std::setw( 14 ) << packedBytes << std::setw( 8 ) << ( GLfloat )floatBytes / packedBytes << std::setw( 14 ) << maxError << std::endl;
+    }
+
+    // Streamed meshes coming and going in the buffer arena: a random one of the live ranges is freed and a new one allocated,
+    // over and over. When everything is freed at the end, coalescing has to leave a single block with all of the capacity
+    // free, which a single range of the whole capacity is then allocated from again.
+    const GLuint ARENA_STAGES = 3;
+    const GLuint ARENA_LIVE[ARENA_STAGES] = { 100, 1000, 10000 };
+    const GLuint ARENA_CAPACITY = 1u << 30, ARENA_OPERATIONS = 1000000;
+    std::cout << std::endl << "== Buffer arena, random meshes of 64 bytes to 64 KB ==" << std::endl;
+    std::cout << std::left << std::setw( 10 ) << "live" << std::right << std::setw( 18 ) << "free + alloc ns"
+              << std::setw( 10 ) << "failed" << std::setw( 10 ) << "blocks" << std::setw( 14 ) << "free bytes" << std::setw( 14 ) << "after free"
+              << std::setw( 14 ) << "free bytes" << std::setw( 14 ) << "reallocated" << std::endl;
+    for ( GLuint stage = 0; stage < ARENA_STAGES; stage++ )
+    {
+        TLSFAllocator allocator;
+        allocator.Init( ARENA_CAPACITY );
+        // Ranges that failed to allocate are marked invalid, like the ones BufferArena::Upload returns, and never freed
+        BufferRange unused = { 0, 0, TLSFAllocator::INVALID };
+        std::vector<BufferRange> live( ARENA_LIVE[stage], unused );
+        GLuint failed = 0;
+        for ( GLuint i = 0; i < live.size( ); i++ )
+        {
+            if ( !allocator.Allocate( 64 + rand( ) % 65472, 12, live[i] ) )
+            {
+                live[i] = unused;
+                failed++;
+            }
+        }
+
+        // Random choices are made up front so the timing only covers the allocator
+        std::vector<GLuint> victims( ARENA_OPERATIONS ), sizes( ARENA_OPERATIONS );
+        for ( GLuint i = 0; i < ARENA_OPERATIONS; i++ )
+        {
+            victims[i] = ( GLuint )( rand( ) % live.size( ) );
+            sizes[i] = 64 + rand( ) % 65472;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+        for ( GLuint i = 0; i < ARENA_OPERATIONS; i++ )
+        {
+            // Vertex ranges of 3 floats and 16 bit index ranges
+            BufferRange &range = live[victims[i]];
+            if ( TLSFAllocator::INVALID != range.block )
+            {
+                allocator.Free( range );
+            }
+            if ( !allocator.Allocate( sizes[i], ( 0 == i % 2 ) ? 12 : 2, range ) )
+            {
+                range = unused;
+                failed++;
+            }
+        }
+        std::chrono::duration<double, std::nano> churn = std::chrono::steady_clock::now( ) - start;
+
+        GLuint blocks = allocator.GetBlockCount( ), freeBytes = allocator.GetFreeBytes( );
+        for ( GLuint i = 0; i < live.size( ); i++ )
+        {
+            if ( TLSFAllocator::INVALID != live[i].block )
+            {
+                allocator.Free( live[i] );
+            }
+        }
+        GLuint blocksAfterFree = allocator.GetBlockCount( ), freeBytesAfterFree = allocator.GetFreeBytes( );
+        BufferRange whole;
+        bool reallocated = allocator.Allocate( allocator.GetCapacity( ), 1, whole );
+        std::cout << std::left << std::setw( 10 ) << ARENA_LIVE[stage] << std::right << std::setw( 18 ) << churn.count( ) / ARENA_OPERATIONS
+                  << std::setw( 10 ) << failed << std::setw( 10 ) << blocks << std::setw( 14 ) << freeBytes << std::setw( 14 ) << blocksAfterFree
+                  << std::setw( 14 ) << freeBytesAfterFree << std::setw( 14 ) << ( reallocated ? "yes" : "no" ) << std::endl;
+    }
+}
+
+// '--bench-cubes': CPU time of the falling cubes of a frame for growing numbers of cubes, on one thread, seen from where
+// the game starts. A frame culls the boxes around where the cubes go over CUBE_BOUNDS_TIME, rebuilt a few times a second
+// and timed in 'worst ms', and looks up the cubes in view only. Moving every cube is timed with the closed form and with
+// the parabola cache of SetTime and the parabolas it looked up, and both have to end in the same place.
+void BenchmarkCubes( )
+{
+    const GLuint STAGES = 4;
+    const GLuint CUBES[STAGES] = { 1000, 10000, 100000, 1000000 };
+    const GLuint FRAMES = 300;
+    const GLfloat FRAME_TIME = 1.0f / 60.0f;
+
+    JobSystem jobs( 1 );
+    glm::mat4 viewProjection = glm::perspective( glm::radians( 45.0f ), 4.0f / 3.0f, NEAR_PLANE, FAR_PLANE ) * camera.GetViewMatrix( );
+
+    std::cout << "== Falling cubes, " << CubeLanes::WIDTH << " per instruction, " << FRAMES << " frames ==" << std::endl;
+    std::cout << std::left << std::setw( 10 ) << "cubes" << std::right << std::setw( 10 ) << "visible" << std::setw( 10 ) << "frame ms"
+              << std::setw( 10 ) << "worst ms" << std::setw( 10 ) << "all ms" << std::setw( 11 ) << "cached ms" << std::setw( 16 ) << "arcs per frame"
+              << std::setw( 14 ) << "cache error" << std::endl;
+    std::cout << std::fixed << std::setprecision( 3 );
+    for ( GLuint stage = 0; stage < STAGES; stage++ )
+    {
+        // Cubes start spread over a few seconds, so they are at every point of their bounces at once
+        srand( 1 );
+        CubeSimulation cubes( STAIRCASE_ORIGIN, staircaseSteps, staircaseRise, staircaseRun, staircaseWidth );
+        for ( GLuint i = 0; i < CUBES[stage]; i++ )
+        {
+            cubes.Add( RandomFloat( -5.0f, 0.0f ), i );
+        }
+
+        // The frames of the game
+        BoxCuller bounds;
+        GLfloat boundsStart = 0.0f;
+        std::vector<GLuint> inside, visible;
+        std::vector<glm::vec3> positions;
+        size_t visibleSum = 0;
+        std::chrono::duration<double, std::milli> frameTime( 0.0 ), worst( 0.0 );
+        for ( GLuint frame = 1; frame <= FRAMES; frame++ )
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+            UpdateCubeBounds( jobs, cubes, frame * FRAME_TIME, frame * FRAME_TIME, bounds, boundsStart );
+            CullBoxes( jobs, bounds, Frustum( viewProjection ), inside, visible );
+            EvaluateCubes( jobs, cubes, visible, frame * FRAME_TIME, positions );
+            std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now( ) - start;
+            frameTime += time;
+            worst = std::max( worst, time );
+            visibleSum += visible.size( );
+        }
+
+        // Every cube, with the closed form and with the cache
+        std::vector<glm::vec3> all( CUBES[stage] );
+        std::chrono::duration<double, std::milli> allTime( 0.0 ), cachedTime( 0.0 );
+        GLuint arcChanges = cubes.GetArcChanges( );
+        for ( GLuint frame = 1; frame <= FRAMES; frame++ )
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+            for ( GLuint i = 0; i < CUBES[stage]; i++ )
+            {
+                all[i] = cubes.GetPositionAt( i, frame * FRAME_TIME );
+            }
+            std::chrono::steady_clock::time_point allDone = std::chrono::steady_clock::now( );
+            cubes.SetTime( frame * FRAME_TIME );
+            allTime += allDone - start;
+            cachedTime += std::chrono::steady_clock::now( ) - allDone;
+        }
+        arcChanges = cubes.GetArcChanges( ) - arcChanges;
+
+        GLfloat maxError = 0.0f;
+        for ( GLuint i = 0; i < CUBES[stage]; i++ )
+        {
+            maxError = std::max( maxError, glm::length( cubes.GetPosition( i ) - all[i] ) );
+        }
+        std::cout << std::left << std::setw( 10 ) << CUBES[stage] << std::right << std::setw( 10 ) << visibleSum / FRAMES
+                  << std::setw( 10 ) << frameTime.count( ) / FRAMES << std::setw( 10 ) << worst.count( ) << std::setw( 10 ) << allTime.count( ) / FRAMES
+                  << std::setw( 11 ) << cachedTime.count( ) / FRAMES << std::setw( 16 ) << ( GLfloat )arcChanges / FRAMES
+                  << std::setw( 14 ) << maxError << std::endl;
+    }
+}
+
+// '--bench-jobs': CPU time of a frame of the work the game loop hands to the job system, the falling cubes in view, transforms
+// and frustum culling, on 1 to as many threads as there are cores, and the speedup over one thread. The results of every
+// thread count are checked against the ones of one thread.
+void BenchmarkJobs( )
+{
+    const GLuint CUBES = 1000000, OBJECTS = 200000, BOXES = 1000000;
+    const GLuint FRAMES = 100;
+    const GLfloat FRAME_TIME = 1.0f / 60.0f;
+    GLuint cores = std::thread::hardware_concurrency( );
+    cores = ( cores > 0 ) ? cores : 1;
+
+    srand( 1 );
+    CubeSimulation cubes( STAIRCASE_ORIGIN, staircaseSteps, staircaseRise, staircaseRun, staircaseWidth );
+    TransformSystem transforms;
+    BoxCuller boxes;
+    boxes.Resize( BOXES );
+    for ( GLuint i = 0; i < CUBES; i++ )
+    {
+        cubes.Add( RandomFloat( -5.0f, 0.0f ), i );
+    }
+    for ( GLuint i = 0; i < OBJECTS; i++ )
+    {
+        transforms.Add( glm::vec3( RandomFloat( -50.0f, 50.0f ), RandomFloat( -50.0f, 50.0f ), RandomFloat( -50.0f, 50.0f ) ), glm::vec3( 0.3f ),
+                        RandomFloat( 0.0f, 6.28f ), glm::vec3( 0.0f, 1.0f, 0.0f ) );
+    }
+    for ( GLuint i = 0; i < BOXES; i++ )
+    {
+        glm::vec3 center( RandomFloat( -100.0f, 100.0f ), RandomFloat( -100.0f, 100.0f ), RandomFloat( -100.0f, 100.0f ) );
+        boxes.SetBox( i, center - glm::vec3( 0.5f ), center + glm::vec3( 0.5f ) );
+    }
+    glm::mat4 projection = glm::perspective( 45.0f, 4.0f / 3.0f, NEAR_PLANE, FAR_PLANE );
+
+    std::cout << "== Job system, " << cores << " cores, " << FRAMES << " frames ==" << std::endl;
+    std::cout << std::left << std::setw( 10 ) << "threads" << std::right << std::setw( 10 ) << "cubes ms" << std::setw( 10 ) << "speedup"
+              << std::setw( 14 ) << "transforms ms" << std::setw( 10 ) << "speedup" << std::setw( 10 ) << "cull ms" << std::setw( 10 ) << "speedup"
+              << std::setw( 10 ) << "errors" << std::endl;
+    std::cout << std::fixed << std::setprecision( 3 );
+    double baseline[3] = { 0.0, 0.0, 0.0 };
+    std::vector<GLuint> inside, visible, expectedVisible, visibleCubes, expectedVisibleCubes;
+    std::vector<glm::vec3> cubePositions, expectedCubePositions;
+    glm::mat4 expectedMVP;
+    for ( GLuint threads = 1; threads <= cores; threads++ )
+    {
+        JobSystem jobs( threads );
+        // Every thread count builds the boxes of the cubes from the start
+        BoxCuller cubeBounds;
+        GLfloat cubeBoundsStart = 0.0f;
+        std::chrono::duration<double, std::milli> times[3] = { std::chrono::duration<double, std::milli>( 0.0 ), std::chrono::duration<double, std::milli>( 0.0 ),
+                                                               std::chrono::duration<double, std::milli>( 0.0 ) };
+        for ( GLuint frame = 0; frame < FRAMES; frame++ )
+        {
+            // Every thread count replays the same frames
+            glm::mat4 viewProjection = projection * glm::lookAt( glm::vec3( 0.0f ), glm::vec3( std::sin( 0.05f * frame ), 0.0f, -std::cos( 0.05f * frame ) ),
+                                                                 glm::vec3( 0.0f, 1.0f, 0.0f ) );
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+            UpdateCubeBounds( jobs, cubes, frame * FRAME_TIME, frame * FRAME_TIME, cubeBounds, cubeBoundsStart );
+            CullBoxes( jobs, cubeBounds, Frustum( viewProjection ), inside, visibleCubes );
+            EvaluateCubes( jobs, cubes, visibleCubes, frame * FRAME_TIME, cubePositions );
+            std::chrono::steady_clock::time_point cubesDone = std::chrono::steady_clock::now( );
+            UpdateTransforms( jobs, transforms, viewProjection );
+            std::chrono::steady_clock::time_point transformsDone = std::chrono::steady_clock::now( );
+            CullBoxes( jobs, boxes, Frustum( viewProjection ), inside, visible );
+            std::chrono::steady_clock::time_point cullDone = std::chrono::steady_clock::now( );
+            times[0] += cubesDone - start;
+            times[1] += transformsDone - cubesDone;
+            times[2] += cullDone - transformsDone;
+        }
+
+        // The last frame of every run ends in the same state
+        GLuint errors = 0;
+        if ( 1 == threads )
+        {
+            expectedVisibleCubes = visibleCubes;
+            expectedCubePositions = cubePositions;
+            expectedMVP = transforms.GetInstances( )[OBJECTS - 1].mvp;
+            expectedVisible = visible;
+        }
+        errors += ( visibleCubes != expectedVisibleCubes || cubePositions != expectedCubePositions ) ? 1 : 0;
+        errors += ( transforms.GetInstances( )[OBJECTS - 1].mvp != expectedMVP ) ? 1 : 0;
+        errors += ( visible != expectedVisible ) ? 1 : 0;
+
+        std::cout << std::left << std::setw( 10 ) << threads << std::right;
+        for ( GLuint i = 0; i < 3; i++ )
+        {
+            baseline[i] = ( 1 == threads ) ? times[i].count( ) : baseline[i];
+            std::cout << std::setw( ( 1 == i ) ? 14 : 10 ) << times[i].count( ) / FRAMES << std::setw( 10 ) << baseline[i] / times[i].count( );
+        }
+        std::cout << std::setw( 10 ) << errors << std::endl;
+    }
+}
+
 // The MAIN function, from here we start the application and run the game loop
-int main( )
+int main( int argc, char *argv[] )
 {
+    // The staircase is set up before anything uses it, the benchmarks included
+    for ( int i = 1; i + 1 < argc; i++ )
+    {
+        if ( std::string( argv[i] ) == "--staircase-steps" )
+        {
+            staircaseSteps = ( GLuint )std::max( std::atoi( argv[++i] ), 1 );
+        }
+        else if ( std::string( argv[i] ) == "--staircase-rise" )
+        {
+            staircaseRise = ( GLfloat )std::atof( argv[++i] );
+        }
+        else if ( std::string( argv[i] ) == "--staircase-run" )
+        {
+            staircaseRun = std::max( ( GLfloat )std::atof( argv[++i] ), 0.01f );
+        }
+        else if ( std::string( argv[i] ) == "--staircase-width" )
+        {
+            staircaseWidth = std::max( ( GLfloat )std::atof( argv[++i] ), 0.01f );
+        }
+    }
+
+    // '--bench-bvh', '--bench-meshes', '--bench-cubes' and '--bench-jobs' only run on the CPU, they don't need a window
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( std::string( argv[i] ) == "--bench-bvh" )
+        {
+            BenchmarkBVH( );
+            return EXIT_SUCCESS;
+        }
+        
+        if ( std::string( argv[i] ) == "--bench-meshes" )
+        {
+            BenchmarkMeshes( );
+            return EXIT_SUCCESS;
+        }
+        
+        if ( std::string( argv[i] ) == "--bench-cubes" )
+        {
+            BenchmarkCubes( );
+            return EXIT_SUCCESS;
+        }
+        
+        if ( std::string( argv[i] ) == "--bench-jobs" )
+        {
+            BenchmarkJobs( );
+            return EXIT_SUCCESS;
+        }
+    }
+
     // Init GLFW
     glfwInit( );
     // Set all the required options for GLFW
@@ -104,7 +982,15 @@ int main( )
     
     // Build and compile our shader program
     Shader lightingShader( "res/shaders/lighting.vs", "res/shaders/lighting.frag" );
+    Shader clusteredShader( "res/shaders/lighting.vs", "res/shaders/lighting.frag", "#define CLUSTERED_SHADING\n" );
+    Shader referenceShader( "res/shaders/lighting.vs", "res/shaders/lighting_reference.frag" );
+    Shader gbufferShader( "res/shaders/lighting.vs", "res/shaders/gbuffer.frag" );
+    Shader deferredAmbientShader( "res/shaders/deferred.vs", "res/shaders/deferred_ambient.frag" );
+    Shader deferredPointShader( "res/shaders/deferred_point.vs", "res/shaders/deferred_point.frag" );
     Shader lampShader( "res/shaders/lamp.vs", "res/shaders/lamp.frag" );
+    Shader depthShader( "res/shaders/depth.vs", "res/shaders/depth.frag" );
+    Shader coverageShader( "res/shaders/coverage.vs", "res/shaders/depth.frag" );
+    Shader proxyShader( "res/shaders/proxy.vs", "res/shaders/depth.frag" );
     GLfloat cube_vertices[] ={
         // Positions            // Normals              // Texture Coords
         -0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,     0.0f,  0.0f,
@@ -150,828 +1036,172 @@ int main( )
         -0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,     0.0f,  1.0f
     };
 
-    // Set up vertex data (and buffer(s)) and attribute pointers
-    GLfloat vertices[] =
+    // The staircase the scene is built around, with its walls and floor
+    Staircase staircaseMesh;
+    staircaseMesh.Generate( staircaseSteps, staircaseRise, staircaseRun, staircaseWidth );
+    const glm::mat4 staircaseModel = glm::translate( glm::mat4( ), STAIRCASE_ORIGIN );
+    // The lamps hang along the walls of the staircase, in world space like everything the lights are compared with
+    std::vector<glm::vec3> pointLightPositions = staircaseMesh.GetLampPositions( NUMBER_OF_POINT_LIGHTS / 2 );
+    for ( GLuint i = 0; i < NUMBER_OF_POINT_LIGHTS; i++ )
     {
-        
-        // x, y, z,   tex0, tex1,
-        // CHAO
-        -100.0f, 0.0f, 100.0f,  0.0f, 1.0f, 0.0f,  0.0f, 1.0f,
-        100.0f, 0.0f, 100.0f,   0.0f, 1.0f, 0.0f,  1.0f, 1.0f,
-        100.0f, 0.0f, -100.0f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f,
-        100.0f, 0.0f, -100.0f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f,
-        -100.0f, 0.0f, -100.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f,
-        -100.0f, 0.0f, 100.0f,  0.0f, 1.0f, 0.0f,  0.0f, 1.0f,
-        
-        // WALLS
-        -5.0f,  0.0f,  -1.0f,    1.0f, 0.0f, 1.0f, 1.0f, 0.0f,
-        -5.0f,  0.0f, -30.0f,    1.0f, 0.0f, 1.0f, 1.0f, 1.0f,
-        -5.0f,  11.0f, -30.0f,   1.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-        -5.0f,  11.0f, -30.0f,   1.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-        -5.0f,  11.0f,  -1.0f,   1.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-        -5.0f,  0.0f,  -1.0f,   1.0f, 0.0f, 1.0f, 1.0f, 0.0f,
-        
-        5.0f,  0.0f,  -1.0f,   -1.0f, 0.0f, 1.0f,  1.0f, 0.0f,
-        5.0f,  0.0f, -30.0f,   -1.0f, 0.0f, 1.0f, 1.0f, 1.0f,
-        5.0f,  11.0f, -30.0f,  -1.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-        5.0f,  11.0f, -30.0f,  -1.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-        5.0f,  11.0f,  -1.0f,  -1.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-        5.0f,  0.0f,  -1.0f,  -1.0f, 0.0f, 1.0f, 1.0f, 0.0f,
-
-        // STAIRS
-        
-        
-        -5.0f, 0.0f, 0.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 0.0f, 0.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 0.0f, -1.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 0.0f, -1.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 0.0f, -1.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 0.0f, 0.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 0.0f, -1.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 0.0f, -1.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 0.3f, -1.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 0.3f, -1.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 0.3f, -1.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 0.0f, -1.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 0.3f, -1.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 0.3f, -1.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 0.3f, -2.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 0.3f, -2.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 0.3f, -2.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 0.3f, -1.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 0.3f, -2.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 0.3f, -2.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 0.6f, -2.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 0.6f, -2.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 0.6f, -2.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 0.3f, -2.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 0.6f, -2.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 0.6f, -2.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 0.6f, -3.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 0.6f, -3.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 0.6f, -3.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 0.6f, -2.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 0.6f, -3.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 0.6f, -3.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 0.9f, -3.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 0.9f, -3.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 0.9f, -3.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 0.6f, -3.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 0.9f, -3.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 0.9f, -3.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 0.9f, -4.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 0.9f, -4.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 0.9f, -4.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 0.9f, -3.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 0.9f, -4.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 0.9f, -4.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 1.2f, -4.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 1.2f, -4.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 1.2f, -4.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 0.9f, -4.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 1.2f, -4.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 1.2f, -4.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 1.2f, -5.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 1.2f, -5.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 1.2f, -5.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 1.2f, -4.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 1.2f, -5.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 1.2f, -5.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 1.5f, -5.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 1.5f, -5.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 1.5f, -5.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 1.2f, -5.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 1.5f, -5.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 1.5f, -5.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 1.5f, -6.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 1.5f, -6.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 1.5f, -6.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 1.5f, -5.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 1.5f, -6.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 1.5f, -6.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 1.8f, -6.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 1.8f, -6.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 1.8f, -6.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 1.5f, -6.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 1.8f, -6.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 1.8f, -6.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 1.8f, -7.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 1.8f, -7.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 1.8f, -7.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 1.8f, -6.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 1.8f, -7.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 1.8f, -7.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 2.1f, -7.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 2.1f, -7.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 2.1f, -7.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 1.8f, -7.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 2.1f, -7.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 2.1f, -7.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 2.1f, -8.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 2.1f, -8.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 2.1f, -8.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 2.1f, -7.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 2.1f, -8.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 2.1f, -8.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 2.4f, -8.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 2.4f, -8.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 2.4f, -8.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 2.1f, -8.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 2.4f, -8.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 2.4f, -8.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 2.4f, -9.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 2.4f, -9.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 2.4f, -9.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 2.4f, -8.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 2.4f, -9.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 2.4f, -9.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 2.7f, -9.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 2.7f, -9.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 2.7f, -9.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 2.4f, -9.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 2.7f, -9.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 2.7f, -9.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 2.7f, -10.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 2.7f, -10.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 2.7f, -10.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 2.7f, -9.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 2.7f, -10.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 2.7f, -10.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 3.0f, -10.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 3.0f, -10.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 3.0f, -10.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 2.7f, -10.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 3.0f, -10.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 3.0f, -10.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 3.0f, -11.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 3.0f, -11.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 3.0f, -11.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 3.0f, -10.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 3.0f, -11.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 3.0f, -11.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 3.3f, -11.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 3.3f, -11.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 3.3f, -11.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 3.0f, -11.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 3.3f, -11.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 3.3f, -11.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 3.3f, -12.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 3.3f, -12.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 3.3f, -12.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 3.3f, -11.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 3.3f, -12.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 3.3f, -12.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 3.6f, -12.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 3.6f, -12.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 3.6f, -12.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 3.3f, -12.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 3.6f, -12.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 3.6f, -12.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 3.6f, -13.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 3.6f, -13.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 3.6f, -13.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 3.6f, -12.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 3.6f, -13.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 3.6f, -13.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 3.9f, -13.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 3.9f, -13.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 3.9f, -13.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 3.6f, -13.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 3.9f, -13.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 3.9f, -13.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 3.9f, -14.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 3.9f, -14.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 3.9f, -14.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 3.9f, -13.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 3.9f, -14.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 3.9f, -14.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 4.2f, -14.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 4.2f, -14.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 4.2f, -14.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 3.9f, -14.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 4.2f, -14.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 4.2f, -14.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 4.2f, -15.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 4.2f, -15.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 4.2f, -15.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 4.2f, -14.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 4.2f, -15.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 4.2f, -15.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 4.5f, -15.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 4.5f, -15.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 4.5f, -15.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 4.2f, -15.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 4.5f, -15.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 4.5f, -15.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 4.5f, -16.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 4.5f, -16.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 4.5f, -16.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 4.5f, -15.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 4.5f, -16.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 4.5f, -16.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 4.8f, -16.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 4.8f, -16.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 4.8f, -16.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 4.5f, -16.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 4.8f, -16.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 4.8f, -16.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 4.8f, -17.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 4.8f, -17.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 4.8f, -17.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 4.8f, -16.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 4.8f, -17.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 4.8f, -17.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 5.1f, -17.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 5.1f, -17.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 5.1f, -17.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 4.8f, -17.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 5.1f, -17.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 5.1f, -17.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 5.1f, -18.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 5.1f, -18.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 5.1f, -18.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 5.1f, -17.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 5.1f, -18.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 5.1f, -18.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 5.4f, -18.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 5.4f, -18.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 5.4f, -18.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 5.1f, -18.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 5.4f, -18.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 5.4f, -18.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 5.4f, -19.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 5.4f, -19.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 5.4f, -19.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 5.4f, -18.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 5.4f, -19.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 5.4f, -19.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 5.7f, -19.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 5.7f, -19.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 5.7f, -19.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 5.4f, -19.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 5.7f, -19.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 5.7f, -19.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 5.7f, -20.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 5.7f, -20.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 5.7f, -20.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 5.7f, -19.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 5.7f, -20.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 5.7f, -20.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 6.0f, -20.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 6.0f, -20.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 6.0f, -20.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 5.7f, -20.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 6.0f, -20.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 6.0f, -20.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 6.0f, -21.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 6.0f, -21.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 6.0f, -21.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 6.0f, -20.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 6.0f, -21.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 6.0f, -21.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 6.3f, -21.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 6.3f, -21.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 6.3f, -21.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 6.0f, -21.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 6.3f, -21.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 6.3f, -21.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 6.3f, -22.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 6.3f, -22.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 6.3f, -22.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 6.3f, -21.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 6.3f, -22.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 6.3f, -22.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 6.6f, -22.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 6.6f, -22.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 6.6f, -22.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 6.3f, -22.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 6.6f, -22.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 6.6f, -22.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 6.6f, -23.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 6.6f, -23.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 6.6f, -23.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 6.6f, -22.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 6.6f, -23.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 6.6f, -23.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 6.9f, -23.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 6.9f, -23.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 6.9f, -23.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 6.6f, -23.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 6.9f, -23.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 6.9f, -23.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 6.9f, -24.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 6.9f, -24.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 6.9f, -24.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 6.9f, -23.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 6.9f, -24.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 6.9f, -24.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 7.2f, -24.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 7.2f, -24.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 7.2f, -24.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 6.9f, -24.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 7.2f, -24.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 7.2f, -24.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 7.2f, -25.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 7.2f, -25.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 7.2f, -25.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 7.2f, -24.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 7.2f, -25.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 7.2f, -25.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 7.5f, -25.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 7.5f, -25.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 7.5f, -25.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 7.2f, -25.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 7.5f, -25.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 7.5f, -25.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 7.5f, -26.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 7.5f, -26.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 7.5f, -26.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 7.5f, -25.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 7.5f, -26.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 7.5f, -26.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 7.8f, -26.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 7.8f, -26.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 7.8f, -26.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 7.5f, -26.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 7.8f, -26.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 7.8f, -26.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 7.8f, -27.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 7.8f, -27.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 7.8f, -27.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 7.8f, -26.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 7.8f, -27.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 7.8f, -27.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 8.1f, -27.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 8.1f, -27.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 8.1f, -27.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 7.8f, -27.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 8.1f, -27.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 8.1f, -27.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 8.1f, -28.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 8.1f, -28.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 8.1f, -28.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 8.1f, -27.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 8.1f, -28.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 8.1f, -28.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 8.4f, -28.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 8.4f, -28.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 8.4f, -28.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 8.1f, -28.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 8.4f, -28.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 8.4f, -28.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 8.4f, -29.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 8.4f, -29.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 8.4f, -29.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 8.4f, -28.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 8.4f, -29.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 8.4f, -29.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 8.7f, -29.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 8.7f, -29.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 8.7f, -29.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 8.4f, -29.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 8.7f, -29.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 8.7f, -29.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 8.7f, -30.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 8.7f, -30.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 8.7f, -30.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 8.7f, -29.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 8.7f, -30.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 8.7f, -30.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 9.0f, -30.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 9.0f, -30.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 9.0f, -30.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 8.7f, -30.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 9.0f, -30.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 9.0f, -30.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 9.0f, -31.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 9.0f, -31.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 9.0f, -31.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 9.0f, -30.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 9.0f, -31.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 9.0f, -31.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 9.3f, -31.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 9.3f, -31.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 9.3f, -31.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 9.0f, -31.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 9.3f, -31.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 9.3f, -31.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 9.3f, -32.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 9.3f, -32.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 9.3f, -32.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 9.3f, -31.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 9.3f, -32.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 9.3f, -32.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 9.6f, -32.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 9.6f, -32.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 9.6f, -32.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 9.3f, -32.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 9.6f, -32.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 9.6f, -32.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 9.6f, -33.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 9.6f, -33.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 9.6f, -33.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 9.6f, -32.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 9.6f, -33.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 9.6f, -33.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 9.9f, -33.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 9.9f, -33.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 9.9f, -33.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 9.6f, -33.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 9.9f, -33.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 9.9f, -33.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 9.9f, -34.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 9.9f, -34.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 9.9f, -34.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 9.9f, -33.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 9.9f, -34.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 9.9f, -34.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 10.2f, -34.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 10.2f, -34.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 10.2f, -34.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 9.9f, -34.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 10.2f, -34.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 10.2f, -34.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 10.2f, -35.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 10.2f, -35.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 10.2f, -35.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 10.2f, -34.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 10.2f, -35.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 10.2f, -35.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 10.5f, -35.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 10.5f, -35.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 10.5f, -35.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 10.2f, -35.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 10.5f, -35.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 10.5f, -35.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 10.5f, -36.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 10.5f, -36.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 10.5f, -36.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 10.5f, -35.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 10.5f, -36.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 10.5f, -36.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 10.8f, -36.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 10.8f, -36.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 10.8f, -36.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 10.5f, -36.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 10.8f, -36.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 10.8f, -36.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 10.8f, -37.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 10.8f, -37.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 10.8f, -37.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 10.8f, -36.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 10.8f, -37.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 10.8f, -37.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 11.1f, -37.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 11.1f, -37.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 11.1f, -37.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 10.8f, -37.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 11.1f, -37.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 11.1f, -37.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 11.1f, -38.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 11.1f, -38.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 11.1f, -38.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 11.1f, -37.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 11.1f, -38.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 11.1f, -38.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 11.4f, -38.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 11.4f, -38.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 11.4f, -38.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 11.1f, -38.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 11.4f, -38.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 11.4f, -38.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 11.4f, -39.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 11.4f, -39.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 11.4f, -39.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 11.4f, -38.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 11.4f, -39.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 11.4f, -39.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 11.7f, -39.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 11.7f, -39.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 11.7f, -39.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 11.4f, -39.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 11.7f, -39.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 11.7f, -39.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 11.7f, -40.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 11.7f, -40.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 11.7f, -40.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 11.7f, -39.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 11.7f, -40.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 11.7f, -40.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 12.0f, -40.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 12.0f, -40.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 12.0f, -40.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 11.7f, -40.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 12.0f, -40.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 12.0f, -40.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 12.0f, -41.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 12.0f, -41.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 12.0f, -41.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 12.0f, -40.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 12.0f, -41.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 12.0f, -41.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 12.3f, -41.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 12.3f, -41.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 12.3f, -41.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 12.0f, -41.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 12.3f, -41.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 12.3f, -41.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 12.3f, -42.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 12.3f, -42.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 12.3f, -42.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 12.3f, -41.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 12.3f, -42.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 12.3f, -42.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 12.6f, -42.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 12.6f, -42.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 12.6f, -42.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 12.3f, -42.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 12.6f, -42.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 12.6f, -42.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 12.6f, -43.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 12.6f, -43.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 12.6f, -43.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 12.6f, -42.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 12.6f, -43.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 12.6f, -43.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 12.9f, -43.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 12.9f, -43.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 12.9f, -43.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 12.6f, -43.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 12.9f, -43.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 12.9f, -43.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 12.9f, -44.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 12.9f, -44.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 12.9f, -44.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 12.9f, -43.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 12.9f, -44.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 12.9f, -44.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 13.2f, -44.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 13.2f, -44.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 13.2f, -44.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 12.9f, -44.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 13.2f, -44.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 13.2f, -44.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 13.2f, -45.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 13.2f, -45.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 13.2f, -45.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 13.2f, -44.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 13.2f, -45.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 13.2f, -45.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 13.5f, -45.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 13.5f, -45.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 13.5f, -45.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 13.2f, -45.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 13.5f, -45.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 13.5f, -45.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 13.5f, -46.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 13.5f, -46.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 13.5f, -46.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 13.5f, -45.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 13.5f, -46.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 13.5f, -46.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 13.8f, -46.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 13.8f, -46.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 13.8f, -46.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 13.5f, -46.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 13.8f, -46.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 13.8f, -46.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 13.8f, -47.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 13.8f, -47.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 13.8f, -47.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 13.8f, -46.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 13.8f, -47.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 13.8f, -47.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 14.1f, -47.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 14.1f, -47.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 14.1f, -47.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 13.8f, -47.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 14.1f, -47.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 14.1f, -47.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 14.1f, -48.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 14.1f, -48.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 14.1f, -48.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 14.1f, -47.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 14.1f, -48.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 14.1f, -48.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 14.4f, -48.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 14.4f, -48.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 14.4f, -48.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 14.1f, -48.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 14.4f, -48.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 14.4f, -48.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 14.4f, -49.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 14.4f, -49.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 14.4f, -49.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 14.4f, -48.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 14.4f, -49.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 14.4f, -49.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 14.7f, -49.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 14.7f, -49.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 14.7f, -49.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 14.4f, -49.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 14.7f, -49.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 14.7f, -49.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 14.7f, -50.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 14.7f, -50.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 14.7f, -50.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 14.7f, -49.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 14.7f, -50.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 14.7f, -50.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 15.0f, -50.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 15.0f, -50.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 15.0f, -50.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 14.7f, -50.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 15.0f, -50.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 15.0f, -50.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 15.0f, -51.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 15.0f, -51.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 15.0f, -51.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 15.0f, -50.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 15.0f, -51.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 15.0f, -51.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 15.3f, -51.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 15.3f, -51.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 15.3f, -51.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 15.0f, -51.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 15.3f, -51.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 15.3f, -51.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 15.3f, -52.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 15.3f, -52.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 15.3f, -52.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 15.3f, -51.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 15.3f, -52.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 15.3f, -52.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 15.6f, -52.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 15.6f, -52.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 15.6f, -52.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 15.3f, -52.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 15.6f, -52.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 15.6f, -52.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 15.6f, -53.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 15.6f, -53.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 15.6f, -53.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 15.6f, -52.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 15.6f, -53.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 15.6f, -53.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 15.9f, -53.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 15.9f, -53.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 15.9f, -53.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 15.6f, -53.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 15.9f, -53.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 15.9f, -53.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 15.9f, -54.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 15.9f, -54.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 15.9f, -54.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 15.9f, -53.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 15.9f, -54.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 15.9f, -54.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 16.2f, -54.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 16.2f, -54.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 16.2f, -54.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 15.9f, -54.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 16.2f, -54.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 16.2f, -54.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 16.2f, -55.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 16.2f, -55.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 16.2f, -55.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 16.2f, -54.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 16.2f, -55.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 16.2f, -55.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 16.5f, -55.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 16.5f, -55.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 16.5f, -55.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 16.2f, -55.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 16.5f, -55.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 16.5f, -55.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 16.5f, -56.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 16.5f, -56.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 16.5f, -56.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 16.5f, -55.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 16.5f, -56.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 16.5f, -56.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 16.8f, -56.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 16.8f, -56.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 16.8f, -56.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 16.5f, -56.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 16.8f, -56.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 16.8f, -56.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 16.8f, -57.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 16.8f, -57.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 16.8f, -57.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 16.8f, -56.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 16.8f, -57.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 16.8f, -57.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 17.1f, -57.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 17.1f, -57.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 17.1f, -57.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 16.8f, -57.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 17.1f, -57.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 17.1f, -57.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 17.1f, -58.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 17.1f, -58.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 17.1f, -58.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 17.1f, -57.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 17.1f, -58.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 17.1f, -58.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 17.4f, -58.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 17.4f, -58.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 17.4f, -58.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 17.1f, -58.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 17.4f, -58.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 17.4f, -58.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 17.4f, -59.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 17.4f, -59.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 17.4f, -59.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 17.4f, -58.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 17.4f, -59.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 17.4f, -59.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 17.7f, -59.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 17.7f, -59.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 17.7f, -59.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 17.4f, -59.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        -5.0f, 17.7f, -59.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        5.0f, 17.7f, -59.0f,     0.0f, 1.0f, 0.0f,     1.0f, 1.0f,
-        5.0f, 17.7f, -60.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        5.0f, 17.7f, -60.0f,     0.0f, 1.0f, 0.0f,     1.0f, 0.0f,
-        -5.0f, 17.7f, -60.0f,     0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
-        -5.0f, 17.7f, -59.0f,     0.0f, 1.0f, 0.0f,     0.0f, 1.0f,
-        -5.0f, 17.7f, -60.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-        5.0f, 17.7f, -60.0f,     0.0f, 0.0f, 1.0f,     1.0f, 0.0f,
-        5.0f, 18.0f, -60.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        5.0f, 18.0f, -60.0f,     0.0f, 0.0f, 1.0f,     1.0f, 1.0f,
-        -5.0f, 18.0f, -60.0f,     0.0f, 0.0f, 1.0f,     0.0f, 1.0f,
-        -5.0f, 17.7f, -60.0f,     0.0f, 0.0f, 1.0f,     0.0f, 0.0f,
-    };
+        pointLightPositions[i] = glm::vec3( staircaseModel * glm::vec4( pointLightPositions[i], 1.0f ) );
+    }
     
-    // Positions all containers
-    glm::vec3 cubePositions[] = {
-        glm::vec3(  -2.0f,   -2.5f,   0.0f    ),
-    };
+    // Meshes are welded into indexed ones and ordered for the post-transform cache and for vertex fetch before they are
+    // uploaded. Nothing draws the cube with more than its positions, so it's welded on them alone.
+    MeshOptimizer cubeOptimizer;
+    GLuint cubeVertexCount = sizeof( cube_vertices ) / ( 8 * sizeof( GLfloat ) );
+    std::vector<GLfloat> cubePositionStream;
+    for ( GLuint i = 0; i < cubeVertexCount; i++ )
+    {
+        cubePositionStream.insert( cubePositionStream.end( ), &cube_vertices[i * 8], &cube_vertices[i * 8 + 3] );
+    }
+    cubeOptimizer.LoadTriangles( cubePositionStream.data( ), cubeVertexCount, 3 );
+    cubeOptimizer.OptimizeVertexCache( );
+    cubeOptimizer.OptimizeVertexFetch( );
     
-    // Positions of the point lights
-    glm::vec3 pointLightPositions[] = {
-        glm::vec3(  -6.9f,  6.2f,  -26.25f      ),
-        glm::vec3(  -6.9f,  5.2f,  -22.5f      ),
-        glm::vec3(  -6.9f,  4.2f,  -18.75f      ),
-        glm::vec3(  -6.9f,  3.2f,  -15.0f      ),
-        glm::vec3(  -6.9f,  2.2f,  -11.25f      ),
-        glm::vec3(  -6.9f,  1.2f,  -7.5f    ),
-        glm::vec3(  -6.9f,  0.2f,  -3.75f      ),
-        
-        glm::vec3(  2.9f,  6.2f,  -26.25f      ),
-        glm::vec3(  2.9f,  5.2f,  -22.5f      ),
-        glm::vec3(  2.9f,  4.2f,  -18.75f      ),
-        glm::vec3(  2.9f,  3.2f,  -15.0f      ),
-        glm::vec3(  2.9f,  2.2f,  -11.25f      ),
-        glm::vec3(  2.9f,  1.2f,  -7.5f    ),
-        glm::vec3(  2.9f,  0.2f,  -3.75f      ),
-        
-    };
+    // Everything that never moves is merged into one world space batch per material: the staircase is the lit one and the
+    // cubes of the fixed lamps, object i for lamp i, the unlit one. Their triangles keep their order, the batches are culled
+    // and drawn in index ranges.
+    StaticBatch litBatch( Staircase::VERTEX_FLOATS, true ), lampBatch( 3, false );
+    GLuint staircaseObject = litBatch.Add( staircaseMesh.GetVertices( ), staircaseMesh.GetIndices( ), staircaseModel );
+    for ( GLuint i = 0; i < NUMBER_OF_POINT_LIGHTS; i++ )
+    {
+        // The size SetLampTransforms gives the lamps
+        lampBatch.Add( cubeOptimizer.GetVertices( ), cubeOptimizer.GetIndices( ), glm::scale( glm::translate( glm::mat4( ), pointLightPositions[i] ), glm::vec3( 0.2f ) ) );
+    }
+    MeshOptimizer litBatchOptimizer, lampBatchOptimizer;
+    litBatchOptimizer.LoadIndexed( litBatch.GetVertices( ).data( ), litBatch.GetVertexCount( ), litBatch.GetIndices( ).data( ), ( GLuint )litBatch.GetIndices( ).size( ), Staircase::VERTEX_FLOATS );
+    litBatchOptimizer.OptimizeVertexFetch( );
+    lampBatchOptimizer.LoadIndexed( lampBatch.GetVertices( ).data( ), lampBatch.GetVertexCount( ), lampBatch.GetIndices( ).data( ), ( GLuint )lampBatch.GetIndices( ).size( ), 3 );
+    lampBatchOptimizer.OptimizeVertexFetch( );
     
-    // First, set the container's VAO (and VBO)
-    GLuint VBO, boxVAO, LIGHT, cube, cubeVAO;
-    glGenVertexArrays( 1, &boxVAO );
-    glGenBuffers( 1, &VBO );
-    glGenBuffers( 1, &LIGHT );
-    glGenBuffers( 1, &cube );
- 
-
-
-    glBindBuffer( GL_ARRAY_BUFFER, VBO );
-    glBufferData( GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW );
+    // '--packed-vertices' stores the lit batch in 16 byte vertices instead of 8 floats, see VertexPacking.h
+    bool packedVertices = false;
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( std::string( argv[i] ) == "--packed-vertices" )
+        {
+            packedVertices = true;
+        }
+    }
+    VertexPacker litBatchPacker;
+    if ( packedVertices )
+    {
+        litBatchPacker.Pack( litBatchOptimizer.GetVertices( ).data( ), litBatchOptimizer.GetVertexCount( ) );
+    }
+    
+    // Every mesh lives in one vertex and one index buffer, in ranges the arenas hand out
+    // Long staircases from '--staircase-steps' get room for the lit batch on top of the usual sizes
+    BufferArena vertexArena, indexArena;
+    vertexArena.Create( VERTEX_ARENA_SIZE + litBatchOptimizer.GetVertexCount( ) * Staircase::VERTEX_FLOATS * ( GLuint )sizeof( GLfloat ) );
+    indexArena.Create( INDEX_ARENA_SIZE + litBatchOptimizer.GetIndexCount( ) * ( GLuint )sizeof( GLuint ) );
+    BufferRange litPositions = packedVertices ? litBatchPacker.UploadPositions( vertexArena ) : litBatchOptimizer.UploadPositions( vertexArena );
+    BufferRange litAttributes = packedVertices ? litBatchPacker.UploadAttributes( vertexArena ) : litBatchOptimizer.UploadAttributes( vertexArena );
+    BufferRange litIndices = litBatchOptimizer.UploadIndices( indexArena );
+    BufferRange lampBatchPositions = lampBatchOptimizer.UploadPositions( vertexArena );
+    BufferRange lampBatchIndices = lampBatchOptimizer.UploadIndices( indexArena );
+    BufferRange cubePositionRange = cubeOptimizer.UploadPositions( vertexArena );
+    BufferRange cubeIndices = cubeOptimizer.UploadIndices( indexArena );
     
-    glBindVertexArray( boxVAO );
-    glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof( GLfloat ), ( GLvoid * )0 );
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof( GLfloat ), ( GLvoid * )( 3 * sizeof( GLfloat ) ) );
-    glEnableVertexAttribArray( 1 );
-    glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof( GLfloat ), ( GLvoid * )( 6 * sizeof( GLfloat ) ) );
-    glEnableVertexAttribArray( 2 );
-    glBindVertexArray( 0 );
+    // First, set the lit batch's VAOs. Positions and the other attributes are separate streams, so the position only VAO the
+    // depth pre-pass draws the staircase with fetches nothing else.
+    GLuint boxVAO, boxPositionVAO;
+    glGenVertexArrays( 1, &boxVAO );
+    glGenVertexArrays( 1, &boxPositionVAO );
+    GLuint staircaseVAOs[] = { boxVAO, boxPositionVAO };
+    for ( GLuint i = 0; i < 2; i++ )
+    {
+        GLState::Get( ).BindVertexArray( staircaseVAOs[i] );
+        // The element buffer binding is part of the VAO
+        GLState::Get( ).BindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexArena.GetBuffer( ) );
+        GLState::Get( ).BindBuffer( GL_ARRAY_BUFFER, vertexArena.GetBuffer( ) );
+        if ( packedVertices )
+        {
+            VertexPacker::SetPositionAttribute( litPositions.offset );
+        }
+        else
+        {
+            glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof( GLfloat ), ( GLvoid * )( size_t )litPositions.offset );
+            glEnableVertexAttribArray( 0 );
+        }
+    }
+    GLState::Get( ).BindVertexArray( boxVAO );
+    if ( packedVertices )
+    {
+        VertexPacker::SetOtherAttributes( litAttributes.offset );
+    }
+    else
+    {
+        glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof( GLfloat ), ( GLvoid * )( size_t )litAttributes.offset );
+        glEnableVertexAttribArray( 1 );
+        glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof( GLfloat ), ( GLvoid * )( litAttributes.offset + 3 * sizeof( GLfloat ) ) );
+        glEnableVertexAttribArray( 2 );
+    }
+    GLState::Get( ).BindVertexArray( 0 );
     
-    glBindBuffer( GL_ARRAY_BUFFER, LIGHT );
-    glBufferData( GL_ARRAY_BUFFER, sizeof(cube_vertices), cube_vertices, GL_STATIC_DRAW );
-    glBindBuffer( GL_ARRAY_BUFFER, cube );
-    glBufferData( GL_ARRAY_BUFFER, sizeof(cube_vertices), cube_vertices, GL_STATIC_DRAW );
-    // Then, we set the light's VAO (VBO stays the same. After all, the vertices are the same for the light object (also a 3D cube))
-    GLuint lightVAO;
+    // The lamp batch, the instanced lamps and the falling cubes only read tightly packed positions. Their VAOs point at the
+    // start of the arena and the draws pick the mesh with a base vertex, so they only differ in their instance buffers.
+    GLuint lampBatchVAO, lightVAO, cubeVAO;
+    glGenVertexArrays( 1, &lampBatchVAO );
     glGenVertexArrays( 1, &lightVAO );
-    glBindVertexArray( lightVAO );
+    glGenVertexArrays( 1, &cubeVAO );
+    GLuint positionVAOs[] = { lampBatchVAO, lightVAO, cubeVAO };
+    for ( GLuint i = 0; i < 3; i++ )
+    {
+        GLState::Get( ).BindVertexArray( positionVAOs[i] );
+        GLState::Get( ).BindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexArena.GetBuffer( ) );
+        GLState::Get( ).BindBuffer( GL_ARRAY_BUFFER, vertexArena.GetBuffer( ) );
+        glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof( GLfloat ), ( GLvoid * )0 );
+        glEnableVertexAttribArray( 0 );
+    }
+    GLState::Get( ).BindVertexArray( 0 );
     
-    // We only need to bind to the VBO (to link it with glVertexAttribPointer), no need to fill it; the VBO's data already contains all we need.
-    glBindBuffer( GL_ARRAY_BUFFER, LIGHT);
-    // Set the vertex attributes (only position data for the lamp))
-    glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof( GLfloat ), ( GLvoid * )0 ); // Note that we skip over the other data in our buffer object (we don't need the normals/textures, only positions).
-    glEnableVertexAttribArray( 0 );
-    glBindVertexArray( 0 );
+    // Per instance model matrices, every mesh is drawn with a single instanced call however many copies there are
+    InstanceBuffer boxInstances, cubeInstances, lampInstances, lampBatchInstances;
+    boxInstances.AttachTo( boxVAO );
+    boxInstances.AttachTo( boxPositionVAO );
+    cubeInstances.AttachTo( cubeVAO );
+    lampInstances.AttachTo( lightVAO );
+    lampBatchInstances.AttachTo( lampBatchVAO );
     
-    glGenVertexArrays( 1, &cubeVAO );
-    glBindVertexArray( cubeVAO );
-    glBindBuffer( GL_ARRAY_BUFFER, cube);
-    // Set the vertex attributes (only position data for the lamp))
-    glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof( GLfloat ), ( GLvoid * )0 ); // Note that we skip over the other data in our buffer object (we don't need the normals/textures, only positions).
-    glEnableVertexAttribArray( 0 );
-    glBindVertexArray( 0 );
+    // Positions, scales and rotations of everything drawn instanced, the matrices are rebuilt from them every frame. The
+    // static batches are already in world space, each is a single instance with the identity transform.
+    TransformSystem boxTransforms, cubeTransforms, lampTransforms, lampBatchTransforms;
+    boxTransforms.Add( glm::vec3( 0.0f ) );
+    lampBatchTransforms.Add( glm::vec3( 0.0f ) );
+    if ( packedVertices )
+    {
+        boxTransforms.SetMeshTransform( litBatchPacker.GetDecodeTransform( ) );
+    }
+    
+    // The staircase is culled per quad (6 indices). Its quads and the fixed lamps never move, so their world space boxes go
+    // into one BVH built at startup: staircase quads first, then one box per lamp of pointLightPositions.
+    const GLuint STAIRCASE_SEGMENT_INDICES = Staircase::QUAD_INDICES;
+    const GLuint STAIRCASE_SEGMENTS = staircaseMesh.GetQuadCount( );
+    const GLuint STAIRCASE_FIRST_INDEX = litBatch.GetFirstIndex( staircaseObject );
+    std::vector<AABB> sceneBoxes( STAIRCASE_SEGMENTS );
+    // The same world space triangles are the occluders of the software occlusion culling
+    std::vector<glm::vec3> staircaseTriangles;
+    for ( GLuint segment = 0; segment < STAIRCASE_SEGMENTS; segment++ )
+    {
+        for ( GLuint i = segment * STAIRCASE_SEGMENT_INDICES; i < ( segment + 1 ) * STAIRCASE_SEGMENT_INDICES; i++ )
+        {
+            staircaseTriangles.push_back( litBatch.GetPosition( STAIRCASE_FIRST_INDEX + i ) );
+            sceneBoxes[segment].Grow( staircaseTriangles.back( ) );
+        }
+    }
+    for ( GLuint i = 0; i < NUMBER_OF_POINT_LIGHTS; i++ )
+    {
+        sceneBoxes.push_back( AABB( pointLightPositions[i] - glm::vec3( 0.1f ), pointLightPositions[i] + glm::vec3( 0.1f ) ) );
+    }
+    BVH sceneBVH;
+    sceneBVH.Build( sceneBoxes );
+    std::vector<GLuint> sceneHits, extraLamps;
+    BoxCuller lampCuller;
+    std::vector<GLuint> visibleSegments, visibleCubes, cubeBlocks, visibleLamps, batchLamps, instancedLamps;
+    std::vector<GLint> staircaseFirsts, lampFirsts;
+    std::vector<GLsizei> staircaseCounts, lampCounts;
     
     // Load textures
     GLuint diffuseMap, specularMap, emissionMap;
@@ -984,7 +1214,7 @@ int main( )
     
     // Diffuse map
     image = SOIL_load_image( "res/images/wall.jpg", &imageWidth, &imageHeight, 0, SOIL_LOAD_RGB );
-    glBindTexture( GL_TEXTURE_2D, diffuseMap );
+    GLState::Get( ).BindTexture( 0, GL_TEXTURE_2D, diffuseMap );
     glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, imageWidth, imageHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, image );
     glGenerateMipmap( GL_TEXTURE_2D );
     SOIL_free_image_data( image );
@@ -993,335 +1223,545 @@ int main( )
     glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
     glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST_MIPMAP_NEAREST );
     
-    // Set texture units
-    lightingShader.Use( );
-    glUniform1i( glGetUniformLocation( lightingShader.Program, "material.diffuse" ), 0 );
-    glUniform1i( glGetUniformLocation( lightingShader.Program, "material.specular" ), 1 );
+    // Draws are queued every frame and issued sorted by state and depth
+    RenderQueue queue;
+    GLuint materialMaps[2] = { diffuseMap, specularMap };
+    GLuint materialSet = queue.AddTextureSet( materialMaps, 2 );
     
-    glm::mat4 projection = glm::perspective( camera.GetZoom( ), ( GLfloat )SCREEN_WIDTH / ( GLfloat )SCREEN_HEIGHT, 0.1f, 100.0f );
+    // Set texture units and material properties of the lit shaders and the G-buffer shader
+    Shader *litShaders[] = { &lightingShader, &clusteredShader, &referenceShader, &gbufferShader };
+    for ( GLuint i = 0; i < 4; i++ )
+    {
+        litShaders[i]->Use( );
+        litShaders[i]->SetInt( UNIFORM_MATERIAL_DIFFUSE, 0 );
+        litShaders[i]->SetInt( UNIFORM_MATERIAL_SPECULAR, 1 );
+        litShaders[i]->SetFloat( UNIFORM_MATERIAL_SHININESS, 10.0f );
+        litShaders[i]->BindUniformBlock( UNIFORM_BLOCK_LIGHTS, LIGHTS_BINDING_POINT );
+    }
+    ClusterGrid::SetSamplers( clusteredShader );
     
-    std::vector<GLfloat> xcube;
-    xcube.push_back(RandomFloat(-5.0f, 5.0f));
- 
-
-    std::vector<GLfloat> zcube;
-    zcube.push_back(-30.0f);
-  
+    // The deferred lighting passes read the G-buffer instead of the material maps
+    Shader *deferredShaders[] = { &deferredAmbientShader, &deferredPointShader };
+    for ( GLuint i = 0; i < 2; i++ )
+    {
+        deferredShaders[i]->Use( );
+        deferredShaders[i]->SetInt( UNIFORM_G_POSITION, GBUFFER_POSITION_UNIT );
+        deferredShaders[i]->SetInt( UNIFORM_G_NORMAL, GBUFFER_NORMAL_UNIT );
+        deferredShaders[i]->SetInt( UNIFORM_G_ALBEDO_SPEC, GBUFFER_ALBEDO_SPEC_UNIT );
+        deferredShaders[i]->SetFloat( UNIFORM_MATERIAL_SHININESS, 10.0f );
+    }
+    deferredAmbientShader.BindUniformBlock( UNIFORM_BLOCK_LIGHTS, LIGHTS_BINDING_POINT );
+    deferredPointShader.SetInt( UNIFORM_POINT_LIGHT_DATA, POINT_LIGHT_UNIT );
+    deferredPointShader.SetFloat( UNIFORM_NEAR_PLANE, NEAR_PLANE );
     
+    GBuffer gbuffer( SCREEN_WIDTH, SCREEN_HEIGHT );
+    // Core profile needs a bound VAO even for draws that build their vertices from gl_VertexID
+    GLuint emptyVAO;
+    glGenVertexArrays( 1, &emptyVAO );
     
-    std::vector<GLfloat> ycube;
-    ycube.push_back(9.0f);
- 
+    // Fill the light uniform block once, every frame after this only the spot light range is re-uploaded
+    LightBuffer lights;
     
-    GLfloat yincrement = 0.0001f;
-    int flag = 1;
-    int max_steps = 30;
-    GLfloat rate = 0.05f;
-    int a = 0;
-    // Game loop
-    while ( !glfwWindowShouldClose( window ) )
+    // Directional light
+    lights.Data.dirLight.direction = glm::vec3( -0.2f, -1.0f, -0.3f );
+    lights.Data.dirLight.ambient = glm::vec3( 0.05f, 0.05f, 0.05f );
+    lights.Data.dirLight.diffuse = glm::vec3( 0.04f, 0.04f, 0.4f );
+    lights.Data.dirLight.specular = glm::vec3( 0.05f, 0.05f, 0.05f );
+    
+    // Point lights, the forward path takes the first 14 from the uniform block while the clustered and deferred paths read all of them from a texture buffer
+    std::vector<PointLightData> sceneLights;
+    GenerateSceneLights( sceneLights, NUMBER_OF_POINT_LIGHTS, pointLightPositions.data( ), NUMBER_OF_POINT_LIGHTS );
+    for ( GLuint i = 0; i < NUMBER_OF_POINT_LIGHTS; i++ )
     {
-        //fps = (1.0f / deltaTimeCube) * 100000000.0f;
-        // Calculate deltatime of current frame
-        GLfloat currentFrame = glfwGetTime( );
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-        GLfloat fps = deltaTime * 10;
+        lights.Data.pointLights[i] = sceneLights[i];
+    }
+    PointLightBuffer pointLightBuffer;
+    pointLightBuffer.Upload( sceneLights );
+    ClusterGrid clusters;
+    clusters.SetLights( sceneLights );
+    SetLampTransforms( lampTransforms, sceneLights );
+    
+    // SpotLight
+    lights.Data.spotLight.position = camera.GetPosition( );
+    lights.Data.spotLight.direction = camera.GetFront( );
+    lights.Data.spotLight.ambient = glm::vec3( 0.0f, 0.0f, 0.0f );
+    lights.Data.spotLight.diffuse = glm::vec3( 1.0f, 1.0f, 1.0f );
+    lights.Data.spotLight.specular = glm::vec3( 1.0f, 1.0f, 1.0f );
+    lights.Data.spotLight.constant = 1.0f;
+    lights.Data.spotLight.linear = 0.09f;
+    lights.Data.spotLight.quadratic = 0.032f;
+    lights.Data.spotLight.cutOff = glm::cos( glm::radians( 12.5f ) );
+    lights.Data.spotLight.outerCutOff = glm::cos( glm::radians( 15.0f ) );
+    
+    lights.Upload( );
+    
+    glm::mat4 projection = glm::perspective( camera.GetZoom( ), ( GLfloat )SCREEN_WIDTH / ( GLfloat )SCREEN_HEIGHT, NEAR_PLANE, FAR_PLANE );
+    
+    // Benchmarks are started from the command line, e.g. 'CG-opengl --bench-lights'
+    Benchmark benchmark;
+    BenchmarkRun benchmarkRun = BENCH_NONE;
+    // '--gl-stats' prints how many state changes the GLState cache dropped, once a second
+    bool printGLStats = false;
+    // '--fragment-stats' prints the fragments shaded by the lit pass per covered pixel, once a second
+    bool printFragmentStats = false;
+    FragmentCounter fragmentCounter;
+    // '--occlusion-stats' prints how many cubes and lamps occlusion culling skipped in the last frame, once a second
+    bool printOcclusionStats = false;
+    OcclusionCuller cubeOcclusion, lampOcclusion;
+    SoftwareOcclusion softwareOcclusion;
+    softwareOcclusion.SetOccluders( staircaseTriangles );
+    GLfloat lastStatsTime = 0.0f;
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( std::string( argv[i] ) == "--gl-stats" )
+        {
+            printGLStats = true;
+        }
         
-        // Check if any events have been activiated (key pressed, mouse moved etc.) and call corresponding response functions
-        glfwPollEvents( );
-        DoMovement( );
+        if ( std::string( argv[i] ) == "--fragment-stats" )
+        {
+            printFragmentStats = true;
+        }
         
-        // Clear the colorbuffer
-        glClearColor( 0.1f, 0.1f, 0.1f, 1.0f );
-        glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+        if ( std::string( argv[i] ) == "--depth-prepass" )
+        {
+            depthPrepass = true;
+        }
         
+        if ( std::string( argv[i] ) == "--occlusion-culling" )
+        {
+            occlusionMode = OCCLUSION_QUERIES;
+        }
         
-        // Use cooresponding shader when setting uniforms/drawing objects
-        lightingShader.Use( );
-        GLint viewPosLoc = glGetUniformLocation( lightingShader.Program, "viewPos" );
-        glUniform3f( viewPosLoc, camera.GetPosition( ).x, camera.GetPosition( ).y, camera.GetPosition( ).z);
-        // Set material properties
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "material.shininess" ), 10.0f );
-        // == ==========================
-        // Here we set all the uniforms for the 5/6 types of lights we have. We have to set them manually and index
-        // the proper PointLight struct in the array to set each uniform variable. This can be done more code-friendly
-        // by defining light types as classes and set their values in there, or by using a more efficient uniform approach
-        // by using 'Uniform buffer objects', but that is something we discuss in the 'Advanced GLSL' tutorial.
-        // == ==========================
+        if ( std::string( argv[i] ) == "--software-occlusion" )
+        {
+            occlusionMode = OCCLUSION_SOFTWARE;
+        }
         
-        // Directional light
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "dirLight.direction" ), -0.2f, -1.0f, -0.3f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "dirLight.ambient" ), 0.05f, 0.05f, 0.05f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "dirLight.diffuse" ), 0.04f, 0.04f, 0.4f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "dirLight.specular" ), 0.05f, 0.05f, 0.05f );
-
-        // Point light 1
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[0].position" ), pointLightPositions[0].x, pointLightPositions[0].y, pointLightPositions[0].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[0].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[0].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[0].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[0].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[0].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[0].quadratic" ), 0.032f );
+        if ( std::string( argv[i] ) == "--occlusion-stats" )
+        {
+            printOcclusionStats = true;
+        }
         
-        // Point light 2
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[1].position" ), pointLightPositions[1].x, pointLightPositions[1].y, pointLightPositions[1].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[1].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[1].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[1].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[1].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[1].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[1].quadratic" ), 0.032f );
+        if ( std::string( argv[i] ) == "--bench-shading" )
+        {
+            benchmarkRun = BENCH_SHADING;
+            benchmark.Start( "Lit pass, forward with 14 point lights", std::vector<std::string>( BENCH_SHADING_NAMES, BENCH_SHADING_NAMES + BENCH_SHADING_STAGES ) );
+        }
         
-        // Point light 3
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[2].position" ), pointLightPositions[2].x, pointLightPositions[2].y, pointLightPositions[2].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[2].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[2].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[2].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[2].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[2].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[2].quadratic" ), 0.032f );
+        if ( std::string( argv[i] ) == "--bench-lights" )
+        {
+            benchmarkRun = BENCH_LIGHTS;
+            std::vector<std::string> stages;
+            for ( GLuint stage = 0; stage < BENCH_LIGHTS_STAGES; stage++ )
+            {
+                stages.push_back( std::string( LIGHTING_MODE_NAMES[BENCH_LIGHTS_MODES[stage]] ) + " " + std::to_string( BENCH_LIGHTS_COUNTS[stage] ) + " lights" );
+            }
+            benchmark.Start( "Frame time by point light count", stages );
+        }
+    }
+    
+    if ( benchmark.IsRunning( ) )
+    {
+        // Measure the frames, not the display's refresh rate
+        glfwSwapInterval( 0 );
+        srand( 1 );
+    }
+    
+    // The falling cube the player has to dodge
+    CubeSimulation fallingCubes( STAIRCASE_ORIGIN, staircaseSteps, staircaseRise, staircaseRun, staircaseWidth );
+    fallingCubes.Add( 0.0f, rand( ) );
+    FixedTimestep simulation( SIMULATION_STEP, MAX_SIMULATION_STEPS );
+    // The cubes, transforms and culling of a frame are split over a thread per core
+    JobSystem jobs( std::thread::hardware_concurrency( ), 1 );
+    std::vector<GLuint> cullBits;
+    // Steps simulated so far, the time of the game without the steps dropped after stalls
+    GLuint simulatedSteps = 0;
+    
+    // From here on this thread handles input and simulates, and a render thread that owns the GL context draws. This thread
+    // publishes a snapshot of every frame for the render thread, so it simulates the next frame while the last one is drawn,
+    // and a slow glfwSwapBuffers never holds up input. The render thread joins the job system for its transforms and culling.
+    TripleBuffer<FrameSnapshot> frames;
+    std::atomic<bool> renderFinished( false );
+    // While a benchmark runs it picks the lighting itself, whatever the snapshot says. Only the render thread uses it, it
+    // starts from the mode set before the input thread takes keys.
+    LightingMode benchmarkLighting = lightingMode;
+    glfwMakeContextCurrent( nullptr );
+    std::thread renderThread( [&]( )
+    {
+        glfwMakeContextCurrent( window );
+        jobs.AttachThread( );
+        while ( frames.WaitAndAcquire( ) )
+        {
+            const FrameSnapshot &frame = frames.GetReadBuffer( );
+            benchmark.BeginFrame( );
+            if ( benchmark.StageStarted( ) && BENCH_LIGHTS == benchmarkRun )
+            {
+                benchmarkLighting = BENCH_LIGHTS_MODES[benchmark.GetStage( )];
+                GenerateSceneLights( sceneLights, BENCH_LIGHTS_COUNTS[benchmark.GetStage( )], pointLightPositions.data( ), NUMBER_OF_POINT_LIGHTS );
+                pointLightBuffer.Upload( sceneLights );
+                clusters.SetLights( sceneLights );
+                SetLampTransforms( lampTransforms, sceneLights );
+            }
         
-        // Point light 4
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[3].position" ), pointLightPositions[3].x, pointLightPositions[3].y, pointLightPositions[3].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[3].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[3].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[3].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[3].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[3].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[3].quadratic" ), 0.032f );
-   
-        // Point light 5
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[4].position" ), pointLightPositions[4].x, pointLightPositions[4].y, pointLightPositions[4].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[4].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[4].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[4].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[4].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[4].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[4].quadratic" ), 0.032f );
+            if ( benchmark.StageStarted( ) && BENCH_SHADING == benchmarkRun )
+            {
+                benchmarkLighting = LIGHTING_FORWARD;
+                referenceShading = ( 0 == benchmark.GetStage( ) );
+            }
         
-        // Point light 6
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[5].position" ), pointLightPositions[5].x, pointLightPositions[5].y, pointLightPositions[5].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[5].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[5].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[5].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[5].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[5].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[5].quadratic" ), 0.032f );
+            LightingMode lightingMode = ( BENCH_NONE != benchmarkRun ) ? benchmarkLighting : frame.lightingMode;
+            bool depthPrepass = frame.depthPrepass;
+            OcclusionMode occlusionMode = frame.occlusionMode;
         
-        // Point light 7
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[6].position" ), pointLightPositions[6].x, pointLightPositions[6].y, pointLightPositions[6].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[6].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[6].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[6].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[6].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[6].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[6].quadratic" ), 0.032f );
+            // Clear the colorbuffer
+            glClearColor( 0.1f, 0.1f, 0.1f, 1.0f );
+            glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
         
-        // Point light 1
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[7].position" ), pointLightPositions[7].x, pointLightPositions[7].y, pointLightPositions[7].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[7].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[7].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[7].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[7].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[7].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[7].quadratic" ), 0.032f );
         
-        // Point light 2
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[8].position" ), pointLightPositions[8].x, pointLightPositions[8].y, pointLightPositions[8].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[8].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[8].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[8].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[8].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[8].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[8].quadratic" ), 0.032f );
+            // Create camera transformations
+            const glm::mat4 &view = frame.view;
+            glm::mat4 viewProjection = projection * view;
         
-        // Point light 3
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[9].position" ), pointLightPositions[9].x, pointLightPositions[9].y, pointLightPositions[9].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[9].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[9].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[9].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[9].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[9].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[9].quadratic" ), 0.032f );
+            // The snapshot only has the falling cubes in view, already culled, and where they are; the other cubes
+            // keep their stale transforms and are never drawn. The staircase and the lamps only need their
+            // model-view-projection rebuilt.
+            visibleCubes = frame.visibleCubes;
+            cubeTransforms.Resize( frame.cubeCount );
+            for ( size_t i = 0; i < visibleCubes.size( ); i++ )
+            {
+                cubeTransforms.SetPosition( visibleCubes[i], frame.cubePositions[i] );
+                cubeTransforms.SetScale( visibleCubes[i], glm::vec3( CUBE_SCALE ) );
+            }
+            UpdateListedTransforms( jobs, cubeTransforms, visibleCubes, viewProjection, cubeBlocks );
+            TransformSystem *transforms[] = { &boxTransforms, &lampTransforms, &lampBatchTransforms };
+            for ( GLuint i = 0; i < 3; i++ )
+            {
+                UpdateTransforms( jobs, *transforms[i], viewProjection );
+            }
         
-        // Point light 4
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[10].position" ), pointLightPositions[10].x, pointLightPositions[10].y, pointLightPositions[10].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[10].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[10].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[10].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[10].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[10].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[10].quadratic" ), 0.032f );
+            // Frustum culling, only what is at least partly in view reaches the draw calls
+            Frustum frustum( viewProjection );
+            sceneHits.clear( );
+            sceneBVH.QueryFrustum( frustum, sceneHits );
+            std::sort( sceneHits.begin( ), sceneHits.end( ) );
+            visibleSegments.clear( );
+            visibleLamps.clear( );
+            for ( size_t i = 0; i < sceneHits.size( ); i++ )
+            {
+                if ( sceneHits[i] < STAIRCASE_SEGMENTS )
+                {
+                    visibleSegments.push_back( sceneHits[i] );
+                }
+                else if ( sceneHits[i] - STAIRCASE_SEGMENTS < lampTransforms.GetCount( ) )
+                {
+                    visibleLamps.push_back( sceneHits[i] - STAIRCASE_SEGMENTS );
+                }
+            }
+            BuildDrawRanges( visibleSegments, ( GLint )STAIRCASE_FIRST_INDEX, STAIRCASE_SEGMENT_INDICES, staircaseFirsts, staircaseCounts );
+            // The first lamps are the fixed ones in the BVH, only the ones '--bench-lights' scatters around are tested here
+            if ( lampTransforms.GetCount( ) > NUMBER_OF_POINT_LIGHTS )
+            {
+                SetCubeBoxes( lampCuller, lampTransforms, 0.2f );
+                CullBoxes( jobs, lampCuller, frustum, cullBits, extraLamps );
+                for ( size_t i = 0; i < extraLamps.size( ); i++ )
+                {
+                    if ( extraLamps[i] >= NUMBER_OF_POINT_LIGHTS )
+                    {
+                        visibleLamps.push_back( extraLamps[i] );
+                    }
+                }
+            }
+            if ( OCCLUSION_SOFTWARE == occlusionMode )
+            {
+                softwareOcclusion.Render( jobs, viewProjection );
+                softwareOcclusion.Cull( visibleCubes, cubeTransforms, CUBE_SCALE );
+                softwareOcclusion.Cull( visibleLamps, lampTransforms, 0.2f );
+            }
+            // The fixed lamps are drawn from their batch, only the ones '--bench-lights' adds are instanced
+            batchLamps.clear( );
+            instancedLamps.clear( );
+            for ( size_t i = 0; i < visibleLamps.size( ); i++ )
+            {
+                ( ( visibleLamps[i] < NUMBER_OF_POINT_LIGHTS ) ? batchLamps : instancedLamps ).push_back( visibleLamps[i] );
+            }
         
-        // Point light 5
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[11].position" ), pointLightPositions[11].x, pointLightPositions[11].y, pointLightPositions[11].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[11].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[11].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[11].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[11].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[11].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[11].quadratic" ), 0.032f );
+            boxInstances.Upload( boxTransforms );
+            lampBatchInstances.Upload( lampBatchTransforms );
+            cubeInstances.Upload( cubeTransforms, visibleCubes );
+            lampInstances.Upload( lampTransforms, instancedLamps );
         
-        // Point light 6
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[12].position" ), pointLightPositions[12].x, pointLightPositions[12].y, pointLightPositions[12].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[12].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[12].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[12].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[12].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[12].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[12].quadratic" ), 0.032f );
+            // The deferred geometry pass renders into the G-buffer, cleared to zero so empty pixels have no normal
+            if ( LIGHTING_DEFERRED == lightingMode )
+            {
+                gbuffer.BindForWriting( );
+                glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+                glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+            }
         
-        // Point light 7
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[13].position" ), pointLightPositions[13].x, pointLightPositions[13].y, pointLightPositions[13].z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[13].ambient" ), 0.2f, 0.2f, 0.2f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[13].diffuse" ), 0.5f, 0.5f, 0.5f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "pointLights[13].specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[13].constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[13].linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "pointLights[13].quadratic" ), 0.032f );
+            // Use cooresponding shader when setting uniforms/drawing objects
+            Shader &forwardShader = referenceShading ? referenceShader : lightingShader;
+            Shader &litShader = ( LIGHTING_DEFERRED == lightingMode ) ? gbufferShader : ( LIGHTING_CLUSTERED == lightingMode ) ? clusteredShader : forwardShader;
+            litShader.Use( );
+            litShader.SetVec3( UNIFORM_VIEW_POS, frame.cameraPosition );
+            // Only the spot light follows the camera, the rest of the light block stays as uploaded at startup
+            lights.SetSpotLight( frame.cameraPosition, frame.cameraFront );
         
-        // SpotLight
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "spotLight.position" ), camera.GetPosition( ).x, camera.GetPosition( ).y, camera.GetPosition( ).z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "spotLight.direction" ), camera.GetFront( ).x, camera.GetFront( ).y, camera.GetFront( ).z );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "spotLight.ambient" ), 0.0f, 0.0f, 0.0f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "spotLight.diffuse" ), 1.0f, 1.0f, 1.0f );
-        glUniform3f( glGetUniformLocation( lightingShader.Program, "spotLight.specular" ), 1.0f, 1.0f, 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "spotLight.constant" ), 1.0f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "spotLight.linear" ), 0.09f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "spotLight.quadratic" ), 0.032f );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "spotLight.cutOff" ), glm::cos( glm::radians( 12.5f ) ) );
-        glUniform1f( glGetUniformLocation( lightingShader.Program, "spotLight.outerCutOff" ), glm::cos( glm::radians( 15.0f ) ) );
+            if ( LIGHTING_CLUSTERED == lightingMode )
+            {
+                // Re-assign the lights to the clusters of the current view
+                clusters.Build( view, projection, NEAR_PLANE, FAR_PLANE );
+                clusters.Bind( );
+                pointLightBuffer.Bind( );
+                ClusterGrid::SetUniforms( litShader, SCREEN_WIDTH, SCREEN_HEIGHT, NEAR_PLANE, FAR_PLANE );
+            }
         
-        // Create camera transformations
-        glm::mat4 view;
-        view = camera.GetViewMatrix( );
+            // Queue the frame: the staircase and every falling cube with the material maps, then one small cube per point light.
+            // Each static batch is one draw and each other mesh one instanced draw whatever the number of copies, unless
+            // occlusion culling draws the lamps and cubes one by one.
+            if ( OCCLUSION_QUERIES == occlusionMode )
+            {
+                cubeOcclusion.BeginFrame( cubeTransforms.GetCount( ) );
+                lampOcclusion.BeginFrame( lampTransforms.GetCount( ) );
+            }
+            queue.Clear( FAR_PLANE );
+            DrawPacket staircase = { &litShader, boxVAO, materialSet, GL_TRIANGLES, 0, 0, ( GLsizei )boxInstances.GetCount( ), staircaseFirsts.data( ), staircaseCounts.data( ), ( GLsizei )staircaseFirsts.size( ) };
+            DrawPacket cubes = { &litShader, cubeVAO, materialSet, GL_TRIANGLES, 0, ( GLsizei )cubeOptimizer.GetIndexCount( ), ( GLsizei )cubeInstances.GetCount( ) };
+            DrawPacket lamps = { &lampShader, lightVAO, 0, GL_TRIANGLES, 0, ( GLsizei )cubeOptimizer.GetIndexCount( ), ( GLsizei )lampInstances.GetCount( ) };
+            DrawPacket lampBatchPacket = { &lampShader, lampBatchVAO, 0, GL_TRIANGLES, 0, 0, ( GLsizei )lampBatchInstances.GetCount( ) };
+            staircase.indexType = litBatchOptimizer.GetIndexType( );
+            staircase.indexOffset = litIndices.offset;
+            staircase.positionVAO = boxPositionVAO;
+            cubes.indexType = cubeOptimizer.GetIndexType( );
+            cubes.indexOffset = cubeIndices.offset;
+            cubes.baseVertex = ( GLint )( cubePositionRange.offset / ( 3 * sizeof( GLfloat ) ) );
+            lamps.indexType = cubes.indexType;
+            lamps.indexOffset = cubes.indexOffset;
+            lamps.baseVertex = cubes.baseVertex;
+            lampBatchPacket.indexType = lampBatchOptimizer.GetIndexType( );
+            lampBatchPacket.indexOffset = lampBatchIndices.offset;
+            lampBatchPacket.baseVertex = ( GLint )( lampBatchPositions.offset / ( 3 * sizeof( GLfloat ) ) );
+            cubes.instances = &cubeInstances;
+            lamps.instances = &lampInstances;
+            GLfloat staircaseDistance = NearestDistance( boxTransforms, frame.cameraPosition );
+            queue.Submit( PASS_GEOMETRY, staircaseDistance, staircase );
+            SubmitInstances( queue, PASS_GEOMETRY, cubes, visibleCubes, cubeTransforms, ( OCCLUSION_QUERIES == occlusionMode ) ? &cubeOcclusion : NULL, depthPrepass ? &depthShader : NULL, frame.cameraPosition );
+            SubmitBatch( queue, PASS_LAMPS, lampBatchPacket, batchLamps, lampBatch, lampFirsts, lampCounts, lampTransforms, ( OCCLUSION_QUERIES == occlusionMode ) ? &lampOcclusion : NULL, frame.cameraPosition );
+            SubmitInstances( queue, PASS_LAMPS, lamps, instancedLamps, lampTransforms, ( OCCLUSION_QUERIES == occlusionMode ) ? &lampOcclusion : NULL, NULL, frame.cameraPosition );
+            if ( depthPrepass )
+            {
+                queue.Submit( PASS_DEPTH, staircaseDistance, DepthOnly( staircase, depthShader ) );
+            }
+            queue.Sort( );
         
-        // Get the uniform locations
-        GLint modelLoc = glGetUniformLocation( lightingShader.Program, "model" );
-        GLint viewLoc = glGetUniformLocation( lightingShader.Program, "view" );
-        GLint projLoc = glGetUniformLocation( lightingShader.Program, "projection" );
-        // Pass the matrices to the shader
-        glUniformMatrix4fv( viewLoc, 1, GL_FALSE, glm::value_ptr( view ) );
-        glUniformMatrix4fv( projLoc, 1, GL_FALSE, glm::value_ptr( projection ) );
+            // Depth only first, then the lit pass keeps the fragments whose depth is exactly the nearest one
+            if ( depthPrepass )
+            {
+                glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+                queue.Execute( PASS_DEPTH );
+                glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+                glDepthFunc( GL_EQUAL );
+                glDepthMask( GL_FALSE );
+            }
         
-        // Bind diffuse map
-        glActiveTexture( GL_TEXTURE0 );
-        glBindTexture( GL_TEXTURE_2D, diffuseMap );
-        // Bind specular map
-        glActiveTexture( GL_TEXTURE1 );
-        glBindTexture( GL_TEXTURE_2D, specularMap );
+            benchmark.BeginGpuSection( );
+            if ( printFragmentStats )
+            {
+                fragmentCounter.BeginShading( );
+            }
+            queue.Execute( PASS_GEOMETRY );
+            if ( printFragmentStats )
+            {
+                fragmentCounter.EndShading( );
+            }
+            benchmark.EndGpuSection( );
         
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // Draw 10 containers with the same VAO and VBO information; only their world space coordinates differ
-        glm::mat4 model;
-        glBindVertexArray( boxVAO );
-        for ( GLuint i = 0; i < 1; i++ )
-        {
-            model = glm::mat4( );
-            model = glm::translate( model, cubePositions[i] );
-            GLfloat angle = 20.0f * i;
-            model = glm::rotate( model, angle, glm::vec3( 1.0f, 0.3f, 0.5f ) );
-            glUniformMatrix4fv( modelLoc, 1, GL_FALSE, glm::value_ptr( model ) );
+            if ( depthPrepass )
+            {
+                glDepthFunc( GL_LESS );
+                glDepthMask( GL_TRUE );
+            }
+        
+            if ( printFragmentStats )
+            {
+                fragmentCounter.MeasureCoverage( coverageShader, emptyVAO );
+            }
+        
+            if ( LIGHTING_DEFERRED == lightingMode )
+            {
+                // The lighting passes read the G-buffer and write to the screen
+                glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+                glDisable( GL_DEPTH_TEST );
+                gbuffer.BindForReading( );
+                GLState::Get( ).BindVertexArray( emptyVAO );
             
-            glDrawArrays( GL_TRIANGLES, 0, 360 );
-        }
-        glBindVertexArray( 0 );
+                // Directional and spot light over the whole screen
+                deferredAmbientShader.Use( );
+                deferredAmbientShader.SetVec3( UNIFORM_VIEW_POS, frame.cameraPosition );
+                glDrawArrays( GL_TRIANGLES, 0, 3 );
+            
+                // Every point light as one screen rectangle around its sphere of influence, added on top
+                glEnable( GL_BLEND );
+                glBlendFunc( GL_ONE, GL_ONE );
+                deferredPointShader.Use( );
+                deferredPointShader.SetVec3( UNIFORM_VIEW_POS, frame.cameraPosition );
+                deferredPointShader.SetMat4( UNIFORM_VIEW, view );
+                deferredPointShader.SetMat4( UNIFORM_PROJECTION, projection );
+                pointLightBuffer.Bind( );
+                glDrawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, pointLightBuffer.GetCount( ) );
+                glDisable( GL_BLEND );
+                glEnable( GL_DEPTH_TEST );
+            
+                // The lamps below are drawn forward, so they need the scene's depth
+                gbuffer.BlitDepth( );
+            }
         
-        for(int i = 0; i < zcube.size(); i++){
-            glBindVertexArray( cubeVAO );
-            model = glm::mat4( );
-            model = glm::translate( model, glm::vec3(  xcube[i],  ycube[i],  zcube[i]) );
-            model = glm::scale(model, glm::vec3( 0.3f ) );
-            glUniformMatrix4fv( modelLoc, 1, GL_FALSE, glm::value_ptr( model ) );
-            glDrawArrays( GL_TRIANGLES, 0, 36 );
-            glBindVertexArray( 0 );
-        }
+            // Also draw the lamp objects, their matrices come with the instances so the lamp shader needs no uniforms
+            queue.Execute( PASS_LAMPS );
         
-        for(int i = 0; i < zcube.size(); i++){
-        GLfloat floor_limit = 0.3f * abs((GLint)(zcube[i]));
-        if(a <= max_steps) // full -> 30
-        {
-            // rise
-            if (flag == 0){
-                ycube[i] += yincrement * fps;
-                if(yincrement > 0.00001f){
-                    yincrement -= rate;
+            // Test the boxes of the cubes and lamps against the finished depth buffer, next frame draws them on the results
+            if ( OCCLUSION_QUERIES == occlusionMode )
+            {
+                cubeOcclusion.IssueQueries( visibleCubes, cubeTransforms, CUBE_SCALE, viewProjection, frame.cameraPosition, proxyShader, emptyVAO );
+                lampOcclusion.IssueQueries( visibleLamps, lampTransforms, 0.2f, viewProjection, frame.cameraPosition, proxyShader, emptyVAO );
+            }
+        
+            // Swap the screen buffers
+            glfwSwapBuffers( window );
+        
+            benchmark.EndFrame( );
+            GLState::Get( ).EndFrame( );
+            if ( printFragmentStats )
+            {
+                fragmentCounter.EndFrame( );
+            }
+            if ( frame.time - lastStatsTime >= 1.0f )
+            {
+                if ( printGLStats )
+                {
+                    PrintGLStats( );
+                }
+                if ( printFragmentStats )
+                {
+                    std::cout << "Lit pass: " << fragmentCounter.GetShadedFragments( ) << ( fragmentCounter.CountsInvocations( ) ? " fragment shader invocations" : " samples passed" )
+                              << " for " << fragmentCounter.GetCoveredPixels( ) << " covered pixels, " << fragmentCounter.GetOverdraw( ) << " per pixel"
+                              << ( depthPrepass ? " (depth pre-pass)" : "" ) << std::endl;
+                }
+                if ( printOcclusionStats && OCCLUSION_QUERIES == occlusionMode )
+                {
+                    std::cout << "Occlusion culling: " << cubeOcclusion.GetCulled( ) << " of " << cubeOcclusion.GetTested( ) << " cubes and "
+                              << lampOcclusion.GetCulled( ) << " of " << lampOcclusion.GetTested( ) << " lamps culled" << std::endl;
                 }
-                zcube[i] += 0.08f;
-            // fall
-            } else {
-                ycube[i] -= yincrement * fps;
-                if(yincrement < 0.5f){
-                    yincrement += 0.05f;
+                if ( printOcclusionStats && OCCLUSION_SOFTWARE == occlusionMode )
+                {
+                    std::cout << "Software occlusion culling: " << softwareOcclusion.GetCulled( ) << " of " << softwareOcclusion.GetTested( )
+                              << " cubes and lamps culled, depth buffer and pyramid in " << softwareOcclusion.GetRenderTime( ) << " ms" << std::endl;
                 }
-                zcube[i] += 0.1f;
+                lastStatsTime = frame.time;
             }
-            
-            ycube[i] = roundf(ycube[i] * 10) / 10;
-            // hit floor
-            if(ycube[i] <= floor_limit-2.35f){
-                flag = 0; // next rise
-                a++;
-                rate += 0.001f; // resistencia
-                ycube[i] = floor_limit-2.4;
-                
-            // peek
-            } else if(yincrement <= 0.00001f){
-                flag = 1; // next fall
-                yincrement = 0.0001f;
-                rate = 0.05f;
-                a++;
+            if ( benchmark.IsFinished( ) )
+            {
+                renderFinished = true;
             }
-        } else {
-            xcube[i] = RandomFloat(-5.0f, 5.0f);
-            zcube[i] = RandomFloat(-40.0f, -20.0f);
-            ycube[i] = 9.0f;
-            yincrement = 0.0001f;
-            flag = 1;
-            a = 0;
-            max_steps -= 2;
-            rate = 0.05f;
-        }
-
-        if(camera.GetPosition().z > zcube[i]-2.0f && camera.GetPosition().z < zcube[i]+2.0f && camera.GetPosition().x > xcube[i]-1.5f && camera.GetPosition().x < xcube[i]+1.5f){
-            glfwSetWindowShouldClose(window, GL_TRUE);
         }
+        
+        glDeleteVertexArrays( 1, &boxVAO );
+        glDeleteVertexArrays( 1, &boxPositionVAO );
+        glDeleteVertexArrays( 1, &cubeVAO );
+        glDeleteVertexArrays( 1, &lightVAO );
+        glDeleteVertexArrays( 1, &lampBatchVAO );
+        vertexArena.Delete( );
+        indexArena.Delete( );
+        boxInstances.Delete( );
+        cubeInstances.Delete( );
+        lampInstances.Delete( );
+        lampBatchInstances.Delete( );
+        lights.Delete( );
+        clusters.Delete( );
+        pointLightBuffer.Delete( );
+        gbuffer.Delete( );
+        benchmark.Delete( );
+        fragmentCounter.Delete( );
+        cubeOcclusion.Delete( );
+        lampOcclusion.Delete( );
+        glDeleteVertexArrays( 1, &emptyVAO );
+    
+        jobs.DetachThread( );
+        glfwMakeContextCurrent( nullptr );
+    } );
+    
+    // Boxes around where the falling cubes go from 'cubeBoundsStart' on, culled on this thread
+    BoxCuller cubeBounds;
+    GLfloat cubeBoundsStart = 0.0f;
+    std::vector<GLuint> cubeBits, nearCubes;
+    
+    // Game loop
+    while ( !glfwWindowShouldClose( window ) )
+    {
+        // Calculate deltatime of current frame
+        GLfloat currentFrame = glfwGetTime( );
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+        
+        // The game is at the last step and draws the frame a little after it, both inside the boxes the cubes are
+        // culled with
+        simulatedSteps += simulation.Advance( deltaTime );
+        GLfloat stepTime = simulatedSteps * SIMULATION_STEP;
+        GLfloat frameTime = ( simulatedSteps + simulation.GetAlpha( ) ) * SIMULATION_STEP;
+        UpdateCubeBounds( jobs, fallingCubes, stepTime, frameTime, cubeBounds, cubeBoundsStart );
+        
+        // The game is over when a cube lands on the camera. Only the cubes whose boxes reach the area around the camera
+        // are looked up at the step.
+        if ( BENCH_NONE == benchmarkRun )
+        {
+            glm::vec3 eye = camera.GetPosition( );
+            CullBoxes( jobs, cubeBounds, Frustum( glm::vec3( eye.x - 1.5f, -FLT_MAX, eye.z - 2.0f ), glm::vec3( eye.x + 1.5f, FLT_MAX, eye.z + 2.0f ) ),
+                       cubeBits, nearCubes );
+            for ( size_t i = 0; i < nearCubes.size( ); i++ )
+            {
+                glm::vec3 cube = fallingCubes.GetPositionAt( nearCubes[i], stepTime );
+                if ( eye.z > cube.z - 2.0f && eye.z < cube.z + 2.0f && eye.x > cube.x - 1.5f && eye.x < cube.x + 1.5f )
+                {
+                    glfwSetWindowShouldClose( window, GL_TRUE );
+                }
+            }
         }
-        // Also draw the lamp object, again binding the appropriate shader
-        lampShader.Use( );
-        // Get location objects for the matrices on the lamp shader (these could be different on a different shader)
-        modelLoc = glGetUniformLocation( lampShader.Program, "model" );
-        viewLoc = glGetUniformLocation( lampShader.Program, "view" );
-        projLoc = glGetUniformLocation( lampShader.Program, "projection" );
-        // Set matrices
-        glUniformMatrix4fv( viewLoc, 1, GL_FALSE, glm::value_ptr( view ) );
-        glUniformMatrix4fv( projLoc, 1, GL_FALSE, glm::value_ptr( projection ) );
-        model = glm::mat4( );
-        model = glm::translate( model, lightPos );
-        model = glm::scale( model, glm::vec3( 0.2f ) ); // Make it a smaller cube
-        glUniformMatrix4fv( modelLoc, 1, GL_FALSE, glm::value_ptr( model ) );
-
-        // We now draw as many light bulbs as we have point lights.
-        glBindVertexArray( lightVAO );
-        for ( GLuint i = 0; i < 14; i++ )
+        
+        // Check if any events have been activiated (key pressed, mouse moved etc.) and call corresponding response functions
+        glfwPollEvents( );
+        DoMovement( );
+        
+        // Only the falling cubes in view are looked up, where they are at the time of the frame
+        FrameSnapshot &frame = frames.GetWriteBuffer( );
+        frame.cubeCount = fallingCubes.GetCount( );
+        CullBoxes( jobs, cubeBounds, Frustum( projection * camera.GetViewMatrix( ) ), cubeBits, frame.visibleCubes );
+        EvaluateCubes( jobs, fallingCubes, frame.visibleCubes, frameTime, frame.cubePositions );
+        frame.time = currentFrame;
+        frame.cameraPosition = camera.GetPosition( );
+        frame.cameraFront = camera.GetFront( );
+        frame.view = camera.GetViewMatrix( );
+        frame.lightingMode = lightingMode;
+        frame.depthPrepass = depthPrepass;
+        frame.occlusionMode = occlusionMode;
+        frames.Publish( );
+        
+        if ( renderFinished )
         {
-            model = glm::mat4( );
-            model = glm::translate( model, pointLightPositions[i] );
-            model = glm::scale( model, glm::vec3( 0.2f ) ); // Make it a smaller cube
-            glUniformMatrix4fv( modelLoc, 1, GL_FALSE, glm::value_ptr( model ) );
-            glDrawArrays( GL_TRIANGLES, 0, 36 );
+            glfwSetWindowShouldClose( window, GL_TRUE );
         }
-        glBindVertexArray( 0 );
         
-        // Swap the screen buffers
-        glfwSwapBuffers( window );
+        // One frame ahead of the render thread at most, but input is still handled every step while a frame takes long
+        frames.WaitUntilRead( SIMULATION_STEP );
     }
     
-    glDeleteVertexArrays( 1, &boxVAO );
-    glDeleteVertexArrays( 1, &lightVAO );
-    glDeleteBuffers( 1, &VBO );
+    frames.Close( );
+    renderThread.join( );
+    
+    // Frames that took longer than MAX_SIMULATION_STEPS steps lost game time, which the frame times above don't show
+    if ( BENCH_NONE != benchmarkRun )
+    {
+        std::cout << "Simulation steps dropped after long frames: " << simulation.GetDroppedSteps( ) << std::endl;
+    }
     
     // Terminate GLFW, clearing any resources allocated by GLFW.
     glfwTerminate( );
@@ -1362,6 +1802,34 @@ void KeyCallback( GLFWwindow *window, int key, int scancode, int action, int mod
         glfwSetWindowShouldClose(window, GL_TRUE);
     }
     
+    // Switch the lighting pipeline
+    if ( GLFW_KEY_1 == key && GLFW_PRESS == action )
+    {
+        lightingMode = LIGHTING_FORWARD;
+    }
+    
+    if ( GLFW_KEY_2 == key && GLFW_PRESS == action )
+    {
+        lightingMode = LIGHTING_CLUSTERED;
+    }
+    
+    if ( GLFW_KEY_3 == key && GLFW_PRESS == action )
+    {
+        lightingMode = LIGHTING_DEFERRED;
+    }
+    
+    // Toggle the depth pre-pass
+    if ( GLFW_KEY_4 == key && GLFW_PRESS == action )
+    {
+        depthPrepass = !depthPrepass;
+    }
+    
+    // Cycle through no occlusion culling, GPU queries and the software depth buffer
+    if ( GLFW_KEY_5 == key && GLFW_PRESS == action )
+    {
+        occlusionMode = ( OcclusionMode )( ( occlusionMode + 1 ) % 3 );
+    }
+    
     
     if ( key >= 0 && key < 1024 )
     {
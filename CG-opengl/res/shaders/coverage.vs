@@ -0,0 +1,8 @@
+#version 330 core
+
+void main()
+{
+    // The full screen triangle of deferred.vs pushed onto the far plane. Tested with GL_GREATER it passes exactly where geometry was drawn
+    vec2 corner = vec2( ( gl_VertexID << 1 ) & 2, gl_VertexID & 2 );
+    gl_Position = vec4( corner * 2.0f - 1.0f, 1.0f, 1.0f );
+}
@@ -0,0 +1,8 @@
+#version 330 core
+
+void main()
+{
+    // One triangle that covers the whole screen, built from the vertex id so no vertex buffer is needed
+    vec2 corner = vec2( ( gl_VertexID << 1 ) & 2, gl_VertexID & 2 );
+    gl_Position = vec4( corner * 2.0f - 1.0f, 0.0f, 1.0f );
+}
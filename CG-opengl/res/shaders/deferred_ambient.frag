@@ -0,0 +1,134 @@
+#version 330 core
+
+// Has to match NUMBER_OF_POINT_LIGHTS in Lights.h
+#define NUMBER_OF_POINT_LIGHTS 14
+
+struct Material
+{
+    float shininess;
+};
+
+// Same structs and block as lighting.frag, keep them in sync with the mirrors in Lights.h
+struct DirLight
+{
+    vec3 direction;
+    
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight
+{
+    vec3 position;
+    float constant;
+    
+    vec3 ambient;
+    float linear;
+    vec3 diffuse;
+    float quadratic;
+    vec3 specular;
+};
+
+struct SpotLight
+{
+    vec3 position;
+    float cutOff;
+    vec3 direction;
+    float outerCutOff;
+    
+    vec3 ambient;
+    float constant;
+    vec3 diffuse;
+    float linear;
+    vec3 specular;
+    float quadratic;
+};
+
+out vec4 color;
+
+uniform vec3 viewPos;
+uniform Material material;
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+
+layout (std140) uniform Lights
+{
+    DirLight dirLight;
+    PointLight pointLights[NUMBER_OF_POINT_LIGHTS];
+    SpotLight spotLight;
+};
+
+// Function prototypes
+vec3 CalcDirLight( DirLight light, vec3 normal, vec3 viewDir, vec3 albedo, float specularity );
+vec3 CalcSpotLight( SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, float specularity );
+
+void main( )
+{
+    // Properties from the G-buffer, pixels the geometry pass never wrote keep the clear color
+    ivec2 pixel = ivec2( gl_FragCoord.xy );
+    vec3 norm = texelFetch( gNormal, pixel, 0 ).xyz;
+    if ( dot( norm, norm ) == 0.0 )
+    {
+        discard;
+    }
+    vec3 fragPos = texelFetch( gPosition, pixel, 0 ).xyz;
+    vec4 albedoSpec = texelFetch( gAlbedoSpec, pixel, 0 );
+    vec3 viewDir = normalize( viewPos - fragPos );
+    
+    // Directional and spot light, the point lights are added on top by their own volumes
+    vec3 result = CalcDirLight( dirLight, norm, viewDir, albedoSpec.rgb, albedoSpec.a );
+    result += CalcSpotLight( spotLight, norm, fragPos, viewDir, albedoSpec.rgb, albedoSpec.a );
+    
+    color = vec4( result, 1.0 );
+}
+
+// Calculates the color when using a directional light.
+vec3 CalcDirLight( DirLight light, vec3 normal, vec3 viewDir, vec3 albedo, float specularity )
+{
+    vec3 lightDir = normalize( -light.direction );
+    
+    // Diffuse shading
+    float diff = max( dot( normal, lightDir ), 0.0 );
+    
+    // Specular shading
+    vec3 reflectDir = reflect( -lightDir, normal );
+    float spec = pow( max( dot( viewDir, reflectDir ), 0.0 ), material.shininess );
+    
+    // Combine results
+    vec3 ambient = light.ambient * albedo;
+    vec3 diffuse = light.diffuse * diff * albedo;
+    vec3 specular = light.specular * spec * specularity;
+    
+    return ( ambient + diffuse + specular );
+}
+
+// Calculates the color when using a spot light.
+vec3 CalcSpotLight( SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, float specularity )
+{
+    vec3 lightDir = normalize( light.position - fragPos );
+    
+    // Diffuse shading
+    float diff = max( dot( normal, lightDir ), 0.0 );
+    
+    // Specular shading
+    vec3 reflectDir = reflect( -lightDir, normal );
+    float spec = pow( max( dot( viewDir, reflectDir ), 0.0 ), material.shininess );
+    
+    // Attenuation
+    float distance = length( light.position - fragPos );
+    float attenuation = 1.0f / ( light.constant + light.linear * distance + light.quadratic * ( distance * distance ) );
+    
+    // Spotlight intensity
+    float theta = dot( lightDir, normalize( -light.direction ) );
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp( ( theta - light.outerCutOff ) / epsilon, 0.0, 1.0 );
+    
+    // Combine results
+    vec3 ambient = light.ambient * albedo;
+    vec3 diffuse = light.diffuse * diff * albedo;
+    vec3 specular = light.specular * spec * specularity;
+    
+    return ( ambient + diffuse + specular ) * attenuation * intensity;
+}
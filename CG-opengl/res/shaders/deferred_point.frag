@@ -0,0 +1,59 @@
+#version 330 core
+
+struct Material
+{
+    float shininess;
+};
+
+flat in int LightIndex;
+flat in float LightRadius;
+
+out vec4 color;
+
+uniform vec3 viewPos;
+uniform Material material;
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+uniform samplerBuffer pointLightData;   // four texels per light, same layout as PointLightData
+
+void main( )
+{
+    // Properties from the G-buffer
+    ivec2 pixel = ivec2( gl_FragCoord.xy );
+    vec3 norm = texelFetch( gNormal, pixel, 0 ).xyz;
+    vec3 fragPos = texelFetch( gPosition, pixel, 0 ).xyz;
+    
+    // The quad is only a bound, pixels outside the sphere of influence (or with no geometry) get nothing
+    vec4 texel0 = texelFetch( pointLightData, 4 * LightIndex );
+    vec3 lightPos = texel0.xyz;
+    float distance = length( lightPos - fragPos );
+    if ( distance > LightRadius || dot( norm, norm ) == 0.0 )
+    {
+        discard;
+    }
+    
+    vec4 texel1 = texelFetch( pointLightData, 4 * LightIndex + 1 );
+    vec4 texel2 = texelFetch( pointLightData, 4 * LightIndex + 2 );
+    vec4 texel3 = texelFetch( pointLightData, 4 * LightIndex + 3 );
+    vec4 albedoSpec = texelFetch( gAlbedoSpec, pixel, 0 );
+    vec3 viewDir = normalize( viewPos - fragPos );
+    vec3 lightDir = normalize( lightPos - fragPos );
+    
+    // Diffuse shading
+    float diff = max( dot( norm, lightDir ), 0.0 );
+    
+    // Specular shading
+    vec3 reflectDir = reflect( -lightDir, norm );
+    float spec = pow( max( dot( viewDir, reflectDir ), 0.0 ), material.shininess );
+    
+    // Attenuation
+    float attenuation = 1.0f / ( texel0.w + texel1.w * distance + texel2.w * ( distance * distance ) );
+    
+    // Combine results, blended additively on top of the other lights
+    vec3 ambient = texel1.xyz * albedoSpec.rgb;
+    vec3 diffuse = texel2.xyz * diff * albedoSpec.rgb;
+    vec3 specular = texel3.xyz * spec * albedoSpec.a;
+    
+    color = vec4( ( ambient + diffuse + specular ) * attenuation, 1.0 );
+}
@@ -0,0 +1,69 @@
+#version 330 core
+
+uniform samplerBuffer pointLightData;   // four texels per light, same layout as PointLightData
+uniform mat4 view;
+uniform mat4 projection;
+uniform float nearPlane;
+
+flat out int LightIndex;
+flat out float LightRadius;
+
+// Distance at which the attenuation drops below 5/256 of the brightest channel, same as LightRadius in Clusters.h
+float CalcRadius( vec4 texel0, vec4 texel1, vec4 texel2, vec4 texel3 )
+{
+    vec3 brightest = max( texel1.xyz, max( texel2.xyz, texel3.xyz ) );
+    float threshold = max( max( brightest.x, brightest.y ), brightest.z ) * 256.0 / 5.0;
+    float constant = texel0.w;
+    float linear = texel1.w;
+    float quadratic = texel2.w;
+    
+    if ( constant >= threshold )
+    {
+        return 0.0;
+    }
+    if ( quadratic > 0.0 )
+    {
+        return ( -linear + sqrt( linear * linear - 4.0 * quadratic * ( constant - threshold ) ) ) / ( 2.0 * quadratic );
+    }
+    return ( linear > 0.0 ) ? ( threshold - constant ) / linear : 1.0e6;
+}
+
+void main()
+{
+    // One instance per light, four strip vertices per instance
+    LightIndex = gl_InstanceID;
+    vec4 texel0 = texelFetch( pointLightData, 4 * gl_InstanceID );
+    LightRadius = CalcRadius( texel0,
+                              texelFetch( pointLightData, 4 * gl_InstanceID + 1 ),
+                              texelFetch( pointLightData, 4 * gl_InstanceID + 2 ),
+                              texelFetch( pointLightData, 4 * gl_InstanceID + 3 ) );
+    
+    // Screen rectangle around the light's sphere of influence, the whole screen once the camera gets inside it
+    vec3 center = vec3( view * vec4( texel0.xyz, 1.0f ) );
+    vec2 ndcMin = vec2( -1.0f );
+    vec2 ndcMax = vec2( 1.0f );
+    if ( -center.z - LightRadius > nearPlane )
+    {
+        ndcMin = vec2( 1.0e9 );
+        ndcMax = vec2( -1.0e9 );
+        for ( int i = 0; i < 8; i++ )
+        {
+            vec3 offset = vec3( ( i & 1 ) != 0 ? LightRadius : -LightRadius,
+                                ( i & 2 ) != 0 ? LightRadius : -LightRadius,
+                                ( i & 4 ) != 0 ? LightRadius : -LightRadius );
+            vec4 clip = projection * vec4( center + offset, 1.0f );
+            ndcMin = min( ndcMin, clip.xy / clip.w );
+            ndcMax = max( ndcMax, clip.xy / clip.w );
+        }
+        ndcMin = clamp( ndcMin, -1.0f, 1.0f );
+        ndcMax = clamp( ndcMax, -1.0f, 1.0f );
+    }
+    else if ( -center.z + LightRadius < nearPlane )
+    {
+        // Entirely behind the camera, collapse the quad
+        ndcMax = ndcMin;
+    }
+    
+    vec2 corner = vec2( gl_VertexID & 1, gl_VertexID >> 1 );
+    gl_Position = vec4( mix( ndcMin, ndcMax, corner ), 0.0f, 1.0f );
+}
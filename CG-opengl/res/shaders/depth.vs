@@ -0,0 +1,11 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 10) in mat4 instanceMVP;
+
+// Same expression as lighting.vs and declared invariant in both, so the lit pass can test its depth with GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+    gl_Position = instanceMVP * vec4(position, 1.0f);
+}
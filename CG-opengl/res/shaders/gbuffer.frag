@@ -0,0 +1,26 @@
+#version 330 core
+layout (location = 0) out vec3 gPosition;
+layout (location = 1) out vec3 gNormal;
+layout (location = 2) out vec4 gAlbedoSpec;
+
+struct Material
+{
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform Material material;
+
+void main( )
+{
+    // Everything the lighting passes need, written once per pixel
+    gPosition = FragPos;
+    gNormal = normalize( Normal );
+    gAlbedoSpec.rgb = texture( material.diffuse, TexCoords ).rgb;
+    gAlbedoSpec.a = texture( material.specular, TexCoords ).r;
+}
@@ -1,11 +1,8 @@
 #version 330 core
 layout (location = 0) in vec3 position;
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (location = 10) in mat4 instanceMVP;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(position, 1.0f);
+    gl_Position = instanceMVP * vec4(position, 1.0f);
 }
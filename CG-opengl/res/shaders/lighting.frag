@@ -1,5 +1,6 @@
 #version 330 core
 
+// Has to match NUMBER_OF_POINT_LIGHTS in Lights.h
 #define NUMBER_OF_POINT_LIGHTS 14
 
 struct Material
@@ -9,6 +10,8 @@ struct Material
     float shininess;
 };
 
+// The light structs live in the std140 'Lights' block below, members are ordered so that every
+// float fills the slot behind a vec3. Keep them in sync with the mirrors in Lights.h
 struct DirLight
 {
     vec3 direction;
@@ -21,30 +24,28 @@ struct DirLight
 struct PointLight
 {
     vec3 position;
-    
     float constant;
-    float linear;
-    float quadratic;
     
     vec3 ambient;
+    float linear;
     vec3 diffuse;
+    float quadratic;
     vec3 specular;
 };
 
 struct SpotLight
 {
     vec3 position;
-    vec3 direction;
     float cutOff;
+    vec3 direction;
     float outerCutOff;
     
-    float constant;
-    float linear;
-    float quadratic;
-    
     vec3 ambient;
+    float constant;
     vec3 diffuse;
+    float linear;
     vec3 specular;
+    float quadratic;
 };
 
 in vec3 FragPos;
@@ -54,15 +55,74 @@ in vec2 TexCoords;
 out vec4 color;
 
 uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NUMBER_OF_POINT_LIGHTS];
-uniform SpotLight spotLight;
 uniform Material material;
 
+layout (std140) uniform Lights
+{
+    DirLight dirLight;
+    PointLight pointLights[NUMBER_OF_POINT_LIGHTS];
+    SpotLight spotLight;
+};
+
+#ifdef CLUSTERED_SHADING
+// Has to match the CLUSTER_* constants in Clusters.h
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+
+uniform usamplerBuffer clusterGrid;         // (first index, light count) per cluster
+uniform usamplerBuffer clusterLightIndices; // light indices of all clusters back to back
+uniform samplerBuffer pointLightData;       // four texels per light, same layout as PointLight
+uniform vec2 clusterTileSize;               // size of a screen tile in pixels
+uniform vec4 clusterZParams;                // near, far, slice scale, slice bias
+
+// Fetches one light of the clustered light list
+PointLight FetchClusterLight( int index )
+{
+    vec4 texel0 = texelFetch( pointLightData, 4 * index );
+    vec4 texel1 = texelFetch( pointLightData, 4 * index + 1 );
+    vec4 texel2 = texelFetch( pointLightData, 4 * index + 2 );
+    vec4 texel3 = texelFetch( pointLightData, 4 * index + 3 );
+    
+    PointLight light;
+    light.position = texel0.xyz;
+    light.constant = texel0.w;
+    light.ambient = texel1.xyz;
+    light.linear = texel1.w;
+    light.diffuse = texel2.xyz;
+    light.quadratic = texel2.w;
+    light.specular = texel3.xyz;
+    return light;
+}
+
+// Finds the cluster this fragment belongs to from its window position and view space depth
+int FindCluster( )
+{
+    float nearPlane = clusterZParams.x;
+    float farPlane = clusterZParams.y;
+    float ndcDepth = gl_FragCoord.z * 2.0 - 1.0;
+    float viewDepth = 2.0 * nearPlane * farPlane / ( farPlane + nearPlane - ndcDepth * ( farPlane - nearPlane ) );
+    
+    int x = min( int( gl_FragCoord.x / clusterTileSize.x ), CLUSTER_X - 1 );
+    int y = min( int( gl_FragCoord.y / clusterTileSize.y ), CLUSTER_Y - 1 );
+    int z = clamp( int( log( viewDepth ) * clusterZParams.z + clusterZParams.w ), 0, CLUSTER_Z - 1 );
+    
+    return x + CLUSTER_X * ( y + CLUSTER_Y * z );
+}
+#endif
+
+// Light intensities summed over all lights, multiplied with the material only once at the end
+struct LightSum
+{
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
 // Function prototypes
-vec3 CalcDirLight( DirLight light, vec3 normal, vec3 viewDir );
-vec3 CalcPointLight( PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir );
-vec3 CalcSpotLight( SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir );
+void AddDirLight( DirLight light, vec3 normal, vec3 viewDir, inout LightSum sum );
+void AddPointLights4( PointLight light0, PointLight light1, PointLight light2, PointLight light3, vec4 mask, vec3 normal, vec3 fragPos, vec3 viewDir, inout LightSum sum );
+void AddSpotLight( SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, inout LightSum sum );
 
 void main( )
 {
@@ -70,98 +130,133 @@ void main( )
     vec3 norm = normalize( Normal );
     vec3 viewDir = normalize( viewPos - FragPos );
     
+    // The material is sampled once per fragment, not once per light
+    vec3 albedo = vec3( texture( material.diffuse, TexCoords ) );
+    vec3 specularity = vec3( texture( material.specular, TexCoords ) );
+    
+    LightSum sum;
+    sum.ambient = vec3( 0.0 );
+    sum.diffuse = vec3( 0.0 );
+    sum.specular = vec3( 0.0 );
+    
     // Directional lighting
-    vec3 result = CalcDirLight( dirLight, norm, viewDir );
+    AddDirLight( dirLight, norm, viewDir, sum );
     
-    // Point lights
-    for ( int i = 0; i < NUMBER_OF_POINT_LIGHTS; i++ )
+    // Point lights, four at a time. Lanes past the last light are masked out
+#ifdef CLUSTERED_SHADING
+    // Only the lights that reach this fragment's cluster
+    uvec2 cluster = texelFetch( clusterGrid, FindCluster( ) ).xy;
+    int first = int( cluster.x );
+    int count = int( cluster.y );
+    for ( int i = 0; i < count; i += 4 )
     {
-        result += CalcPointLight( pointLights[i], norm, FragPos, viewDir );
+        ivec4 slot = min( ivec4( i, i + 1, i + 2, i + 3 ), count - 1 ) + first;
+        vec4 mask = vec4( lessThan( ivec4( i, i + 1, i + 2, i + 3 ), ivec4( count ) ) );
+        AddPointLights4( FetchClusterLight( int( texelFetch( clusterLightIndices, slot.x ).x ) ),
+                         FetchClusterLight( int( texelFetch( clusterLightIndices, slot.y ).x ) ),
+                         FetchClusterLight( int( texelFetch( clusterLightIndices, slot.z ).x ) ),
+                         FetchClusterLight( int( texelFetch( clusterLightIndices, slot.w ).x ) ),
+                         mask, norm, FragPos, viewDir, sum );
     }
+#else
+    for ( int i = 0; i < NUMBER_OF_POINT_LIGHTS; i += 4 )
+    {
+        ivec4 light = min( ivec4( i, i + 1, i + 2, i + 3 ), NUMBER_OF_POINT_LIGHTS - 1 );
+        vec4 mask = vec4( lessThan( ivec4( i, i + 1, i + 2, i + 3 ), ivec4( NUMBER_OF_POINT_LIGHTS ) ) );
+        AddPointLights4( pointLights[light.x], pointLights[light.y], pointLights[light.z], pointLights[light.w], mask, norm, FragPos, viewDir, sum );
+    }
+#endif
     
     // Spot light
-    result += CalcSpotLight( spotLight, norm, FragPos, viewDir );
+    AddSpotLight( spotLight, norm, FragPos, viewDir, sum );
     
-    color = vec4( result, 1.0 );
+    color = vec4( ( sum.ambient + sum.diffuse ) * albedo + sum.specular * specularity, 1.0 );
 }
 
-// Calculates the color when using a directional light.
-vec3 CalcDirLight( DirLight light, vec3 normal, vec3 viewDir )
+// Adds a directional light.
+void AddDirLight( DirLight light, vec3 normal, vec3 viewDir, inout LightSum sum )
 {
     vec3 lightDir = normalize( -light.direction );
     
     // Diffuse shading
     float diff = max( dot( normal, lightDir ), 0.0 );
     
-    // Specular shading
-    vec3 reflectDir = reflect( -lightDir, normal );
-    float spec = pow( max( dot( viewDir, reflectDir ), 0.0 ), material.shininess );
-    
-    // Combine results
-    vec3 ambient = light.ambient * vec3( texture( material.diffuse, TexCoords ) );
-    vec3 diffuse = light.diffuse * diff * vec3( texture( material.diffuse, TexCoords ) );
-    vec3 specular = light.specular * spec * vec3( texture( material.specular, TexCoords ) );
+    // Specular shading, no pow needed when the highlight can't show
+    float reflection = max( dot( viewDir, reflect( -lightDir, normal ) ), 0.0 );
+    float spec = ( reflection > 0.0 ) ? pow( reflection, material.shininess ) : 0.0;
     
-    return ( ambient + diffuse + specular );
+    sum.ambient += light.ambient;
+    sum.diffuse += light.diffuse * diff;
+    sum.specular += light.specular * spec;
 }
 
-// Calculates the color when using a point light.
-vec3 CalcPointLight( PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir )
+// Adds four point lights. Distances, attenuation, diffuse and specular factors are computed in the lanes of a vec4,
+// only the final color sums are done per light.
+void AddPointLights4( PointLight light0, PointLight light1, PointLight light2, PointLight light3, vec4 mask, vec3 normal, vec3 fragPos, vec3 viewDir, inout LightSum sum )
 {
-    vec3 lightDir = normalize( light.position - fragPos );
-    
-    // Diffuse shading
-    float diff = max( dot( normal, lightDir ), 0.0 );
-    
-    // Specular shading
-    vec3 reflectDir = reflect( -lightDir, normal );
-    float spec = pow( max( dot( viewDir, reflectDir ), 0.0 ), material.shininess );
+    vec3 toLight0 = light0.position - fragPos;
+    vec3 toLight1 = light1.position - fragPos;
+    vec3 toLight2 = light2.position - fragPos;
+    vec3 toLight3 = light3.position - fragPos;
     
     // Attenuation
-    float distance = length( light.position - fragPos );
-    float attenuation = 1.0f / ( light.constant + light.linear * distance + light.quadratic * ( distance * distance ) );
+    vec4 distance2 = vec4( dot( toLight0, toLight0 ), dot( toLight1, toLight1 ), dot( toLight2, toLight2 ), dot( toLight3, toLight3 ) );
+    vec4 invDistance = inversesqrt( distance2 );
+    vec4 distance = distance2 * invDistance;
+    vec4 constant = vec4( light0.constant, light1.constant, light2.constant, light3.constant );
+    vec4 linear = vec4( light0.linear, light1.linear, light2.linear, light3.linear );
+    vec4 quadratic = vec4( light0.quadratic, light1.quadratic, light2.quadratic, light3.quadratic );
+    vec4 attenuation = mask / ( constant + linear * distance + quadratic * distance2 );
     
-    // Combine results
-    vec3 ambient = light.ambient * vec3( texture( material.diffuse, TexCoords ) );
-    vec3 diffuse = light.diffuse * diff * vec3( texture( material.diffuse, TexCoords ) );
-    vec3 specular = light.specular * spec * vec3( texture( material.specular, TexCoords ) );
+    // Diffuse shading
+    vec3 lightDir0 = toLight0 * invDistance.x;
+    vec3 lightDir1 = toLight1 * invDistance.y;
+    vec3 lightDir2 = toLight2 * invDistance.z;
+    vec3 lightDir3 = toLight3 * invDistance.w;
+    vec4 diff = max( vec4( dot( normal, lightDir0 ), dot( normal, lightDir1 ), dot( normal, lightDir2 ), dot( normal, lightDir3 ) ), 0.0 );
     
-    ambient *= attenuation;
-    diffuse *= attenuation;
-    specular *= attenuation;
+    // Specular shading, one vec4 pow for the four lights and none at all when no highlight can show
+    vec4 reflection = max( vec4( dot( viewDir, reflect( -lightDir0, normal ) ),
+                                 dot( viewDir, reflect( -lightDir1, normal ) ),
+                                 dot( viewDir, reflect( -lightDir2, normal ) ),
+                                 dot( viewDir, reflect( -lightDir3, normal ) ) ), 0.0 );
+    vec4 spec = any( greaterThan( reflection, vec4( 0.0 ) ) ) ? pow( reflection, vec4( material.shininess ) ) : vec4( 0.0 );
     
-    return ( ambient + diffuse + specular );
+    // Combine results
+    vec4 diffuseWeight = attenuation * diff;
+    vec4 specularWeight = attenuation * spec;
+    sum.ambient += light0.ambient * attenuation.x + light1.ambient * attenuation.y + light2.ambient * attenuation.z + light3.ambient * attenuation.w;
+    sum.diffuse += light0.diffuse * diffuseWeight.x + light1.diffuse * diffuseWeight.y + light2.diffuse * diffuseWeight.z + light3.diffuse * diffuseWeight.w;
+    sum.specular += light0.specular * specularWeight.x + light1.specular * specularWeight.y + light2.specular * specularWeight.z + light3.specular * specularWeight.w;
 }
 
-// Calculates the color when using a spot light.
-vec3 CalcSpotLight( SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir )
+// Adds a spot light, fragments outside the outer cone return before any shading is done.
+void AddSpotLight( SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, inout LightSum sum )
 {
-    vec3 lightDir = normalize( light.position - fragPos );
-    
-    // Diffuse shading
-    float diff = max( dot( normal, lightDir ), 0.0 );
-    
-    // Specular shading
-    vec3 reflectDir = reflect( -lightDir, normal );
-    float spec = pow( max( dot( viewDir, reflectDir ), 0.0 ), material.shininess );
-    
-    // Attenuation
-    float distance = length( light.position - fragPos );
-    float attenuation = 1.0f / ( light.constant + light.linear * distance + light.quadratic * ( distance * distance ) );
+    vec3 toLight = light.position - fragPos;
+    float distance = length( toLight );
+    vec3 lightDir = toLight / distance;
     
     // Spotlight intensity
     float theta = dot( lightDir, normalize( -light.direction ) );
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp( ( theta - light.outerCutOff ) / epsilon, 0.0, 1.0 );
+    if ( intensity <= 0.0 )
+    {
+        return;
+    }
     
-    // Combine results
-    vec3 ambient = light.ambient * vec3( texture( material.diffuse, TexCoords ) );
-    vec3 diffuse = light.diffuse * diff * vec3( texture( material.diffuse, TexCoords ) );
-    vec3 specular = light.specular * spec * vec3( texture( material.specular, TexCoords ) );
+    // Diffuse shading
+    float diff = max( dot( normal, lightDir ), 0.0 );
+    
+    // Specular shading
+    float reflection = max( dot( viewDir, reflect( -lightDir, normal ) ), 0.0 );
+    float spec = ( reflection > 0.0 ) ? pow( reflection, material.shininess ) : 0.0;
     
-    ambient *= attenuation * intensity;
-    diffuse *= attenuation * intensity;
-    specular *= attenuation * intensity;
+    // Attenuation
+    float weight = intensity / ( light.constant + light.linear * distance + light.quadratic * ( distance * distance ) );
     
-    return ( ambient + diffuse + specular );
+    sum.ambient += light.ambient * weight;
+    sum.diffuse += light.diffuse * diff * weight;
+    sum.specular += light.specular * spec * weight;
 }
@@ -2,19 +2,22 @@
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoords;
+// Per instance matrices built on the CPU, see Transforms.h
+layout (location = 3) in mat4 instanceModel;
+layout (location = 7) in mat3 instanceNormal;
+layout (location = 10) in mat4 instanceMVP;
 
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Must match depth.vs bit for bit for the GL_EQUAL test after the depth pre-pass
+invariant gl_Position;
 
 void main()
 {
-    gl_Position = projection * view *  model * vec4(position, 1.0f);
-    FragPos = vec3(model * vec4(position, 1.0f));
-    Normal = mat3(transpose(inverse(model))) * normal;
+    gl_Position = instanceMVP * vec4(position, 1.0f);
+    FragPos = vec3(instanceModel * vec4(position, 1.0f));
+    Normal = instanceNormal * normal;
     TexCoords = texCoords;
 }
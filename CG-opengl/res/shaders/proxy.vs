@@ -0,0 +1,13 @@
+#version 330 core
+
+uniform vec3 boxMin;
+uniform vec3 boxMax;
+uniform mat4 viewProjection;
+
+void main()
+{
+    // Corner of the box for each of the 14 vertices of a triangle strip covering all six faces, one bit mask per axis
+    int bit = 1 << gl_VertexID;
+    vec3 corner = vec3( ( 0x287A & bit ) != 0, ( 0x02AF & bit ) != 0, ( 0x31E3 & bit ) != 0 );
+    gl_Position = viewProjection * vec4( mix( boxMin, boxMax, corner ), 1.0f );
+}